@@ -1,8 +1,8 @@
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
-CONFIG += c++11
+CONFIG += c++17
 
 # The following define makes your compiler emit warnings if you use
 # any Qt feature that has been marked deprecated (the exact warnings
@@ -15,22 +15,31 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(core.pri)
+
 SOURCES += \
+    batcheditdialog.cpp \
+    commanddelegate.cpp \
     commandeditdialog.cpp \
-    htmldelegate.cpp \
     main.cpp \
     mainwindow.cpp \
-    tsccommand.cpp
+    mergedialog.cpp \
+    scriptvalidationdialog.cpp
 
 HEADERS += \
+    batcheditdialog.h \
+    commanddelegate.h \
     commandeditdialog.h \
-    htmldelegate.h \
     mainwindow.h \
-    tsccommand.h
+    mergedialog.h \
+    scriptvalidationdialog.h
 
 FORMS += \
+    batcheditdialog.ui \
     commandeditdialog.ui \
-    mainwindow.ui
+    mainwindow.ui \
+    mergedialog.ui \
+    scriptvalidationdialog.ui
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
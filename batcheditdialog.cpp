@@ -0,0 +1,79 @@
+#include "batcheditdialog.h"
+#include "ui_batcheditdialog.h"
+
+#include "tsctrace.h"
+
+namespace {
+
+Qt::CheckState commonState(const QVector<TSCCommand> &cmds, bool (TSCCommand::*flag)() const)
+{
+    int set = 0;
+    for (const TSCCommand &cmd : cmds) {
+        if ((cmd.*flag)())
+            set++;
+    }
+    if (set == 0)
+        return Qt::Unchecked;
+    return set == cmds.size() ? Qt::Checked : Qt::PartiallyChecked;
+}
+
+}
+
+BatchEditDialog::BatchEditDialog(const QVector<TSCCommand> &cmds, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::BatchEditDialog)
+{
+    TSC_TRACE("BatchEditDialog::BatchEditDialog");
+    ui->setupUi(this);
+
+    ui->lblSummary->setText(QString("Editing %1 commands. Partially checked flags are left as they are.").arg(cmds.size()));
+
+    ui->cbEndsEvent->setCheckState(commonState(cmds, &TSCCommand::endsEvent));
+    ui->cbClearsTextbox->setCheckState(commonState(cmds, &TSCCommand::clearsTextbox));
+    ui->cbParamsAreSeparated->setCheckState(commonState(cmds, &TSCCommand::paramsAreSeparated));
+
+    ui->cbParamSlot->addItem("Any", 0);
+    for (int i = 1; i <= TSCCommand::MaxParams; i++)
+        ui->cbParamSlot->addItem(QString("#%1").arg(i), i);
+    // switching a parameter to or from "None" would change the parameter count, so that's not offered
+    ui->cbFromType->addItem("Any type", 0u);
+    for (const QPair<TSCCommand::ParameterType, QString> &type : TSCCommand::paramTypeNames) {
+        if (type.first == TSCCommand::None)
+            continue;
+        ui->cbFromType->addItem(type.second, type.first);
+        ui->cbToType->addItem(type.second, type.first);
+    }
+}
+
+BatchEditDialog::~BatchEditDialog()
+{
+    delete ui;
+}
+
+bool BatchEditDialog::apply(TSCCommand *cmd) const
+{
+    quint8 oldFlags = cmd->packedFlags();
+    if (ui->cbEndsEvent->checkState() != Qt::PartiallyChecked)
+        cmd->setEndsEvent(ui->cbEndsEvent->isChecked());
+    if (ui->cbClearsTextbox->checkState() != Qt::PartiallyChecked)
+        cmd->setClearsTextbox(ui->cbClearsTextbox->isChecked());
+    if (ui->cbParamsAreSeparated->checkState() != Qt::PartiallyChecked)
+        cmd->setParamsAreSeparated(ui->cbParamsAreSeparated->isChecked());
+    bool changed = cmd->packedFlags() != oldFlags;
+
+    if (ui->gbParamTypes->isChecked()) {
+        int slot = ui->cbParamSlot->currentData().toInt();
+        uint from = ui->cbFromType->currentData().toUInt();
+        TSCCommand::ParameterType to = static_cast<TSCCommand::ParameterType>(ui->cbToType->currentData().toUInt());
+        int count = cmd->paramCount();
+        for (int i = 0; i < count; i++) {
+            if ((slot != 0 && i != slot - 1) || (from != 0 && static_cast<uint>(cmd->params[i].type) != from))
+                continue;
+            if (cmd->params[i].type != to) {
+                cmd->params[i].type = to;
+                changed = true;
+            }
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,30 @@
+#ifndef BATCHEDITDIALOG_H
+#define BATCHEDITDIALOG_H
+
+#include <QDialog>
+#include "tsccommand.h"
+
+namespace Ui {
+class BatchEditDialog;
+}
+
+// Edits the flags and parameter types of several commands at once.
+// Flags start out checked/unchecked if all the commands agree and partially
+// checked otherwise; partially checked flags are left alone.
+
+class BatchEditDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit BatchEditDialog(const QVector<TSCCommand> &cmds, QWidget *parent = nullptr);
+    ~BatchEditDialog();
+
+    // applies the chosen changes to cmd, returns false if that didn't change anything
+    bool apply(TSCCommand *cmd) const;
+
+private:
+    Ui::BatchEditDialog *ui;
+};
+
+#endif // BATCHEDITDIALOG_H
@@ -0,0 +1,26 @@
+# Headless benchmarks for the list reading/writing, sorting, searching and
+# painting paths, run against generated tsc_list files, plus the .tsc codec.
+# Results can be written in a machine-readable format with QTest's own
+# options, e.g. "./bench -o results.xml,xml" or "./bench -csv".
+
+QT += core gui widgets concurrent testlib
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = bench
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../core.pri)
+
+SOURCES += \
+    ../commanddelegate.cpp \
+    ../htmldelegate.cpp \
+    tsclistbenchmark.cpp \
+    tsclistgenerator.cpp
+
+HEADERS += \
+    ../commanddelegate.h \
+    ../htmldelegate.h \
+    tsclistgenerator.h
@@ -0,0 +1,406 @@
+#include <QtTest>
+#include <QListView>
+#include <QPainter>
+#include "tsclistgenerator.h"
+#include "tscdocument.h"
+#include "tsclistwriter.h"
+#include "tsccodec.h"
+#include "commanddelegate.h"
+#include "htmldelegate.h"
+
+// List sizes go up to 1,000,000 commands; set TSCBENCH_MAX_COMMANDS to stop earlier.
+// Painting needs a QApplication, so run with QT_QPA_PLATFORM=offscreen on headless machines.
+
+class TSCListBenchmark : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+    QVector<int> counts;
+    QHash<QString, QString> files;
+
+    void addSizeRows();
+    QString listFile(int count, bool extendedFormat);
+    TSCCommandTable loadTable(int count, bool extendedFormat);
+    static QByteArray pattern(qint64 size);
+    QByteArray transcode(const QByteArray &data, bool decode);
+
+private slots:
+    void initTestCase();
+
+    void load_data();
+    void load();
+    void loadCached_data();
+    void loadCached();
+    void serialize_data();
+    void serialize();
+    void save_data();
+    void save();
+    void sort_data();
+    void sort();
+    void setCommands_data();
+    void setCommands();
+    void batchEdit_data();
+    void batchEdit();
+    void buildIndex_data();
+    void buildIndex();
+    void search_data();
+    void search();
+    void paint_data();
+    void paint();
+    void codecRoundTrip();
+    void codec_data();
+    void codec();
+};
+
+void TSCListBenchmark::initTestCase()
+{
+    QVERIFY(dir.isValid());
+    int maxCount = qEnvironmentVariableIsSet("TSCBENCH_MAX_COMMANDS") ? qEnvironmentVariableIntValue("TSCBENCH_MAX_COMMANDS") : 1000000;
+    for (int count = 100; count <= maxCount; count *= 10)
+        counts += count;
+}
+
+void TSCListBenchmark::addSizeRows()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("extendedFormat");
+    for (int count : counts) {
+        QTest::addRow("CE_TSC/%d", count) << count << false;
+        QTest::addRow("BL_TSC/%d", count) << count << true;
+    }
+}
+
+QString TSCListBenchmark::listFile(int count, bool extendedFormat)
+{
+    QString name = QString("%1_%2.txt").arg(extendedFormat ? "bl" : "ce").arg(count);
+    if (!files.contains(name)) {
+        QString fail;
+        QString path = dir.filePath(name);
+        if (!TSCListWriter::writeFile(path, TSCListGenerator::generate(count, extendedFormat), &fail))
+            qFatal("Could not generate %s: %s", qPrintable(path), qPrintable(fail));
+        files.insert(name, path);
+    }
+    return files.value(name);
+}
+
+TSCCommandTable TSCListBenchmark::loadTable(int count, bool extendedFormat)
+{
+    TSCDocument::LoadResult result = TSCDocument::readFile(listFile(count, extendedFormat), false);
+    if (!result.ok)
+        qFatal("Could not load generated list: %s", qPrintable(result.message));
+    return result.commands;
+}
+
+void TSCListBenchmark::load_data()
+{
+    addSizeRows();
+}
+
+void TSCListBenchmark::load()
+{
+    QFETCH(int, count);
+    QFETCH(bool, extendedFormat);
+    QString path = listFile(count, extendedFormat);
+    QBENCHMARK {
+        TSCDocument::LoadResult result = TSCDocument::readFile(path, false);
+        QVERIFY(result.ok);
+    }
+}
+
+void TSCListBenchmark::loadCached_data()
+{
+    addSizeRows();
+}
+
+void TSCListBenchmark::loadCached()
+{
+    QFETCH(int, count);
+    QFETCH(bool, extendedFormat);
+    QString path = listFile(count, extendedFormat);
+    // the first load writes the .tscbin in the background
+    QVERIFY(TSCDocument::readFile(path, true).ok);
+    QThreadPool::globalInstance()->waitForDone();
+    QBENCHMARK {
+        TSCDocument::LoadResult result = TSCDocument::readFile(path, true);
+        QVERIFY(result.ok);
+    }
+}
+
+void TSCListBenchmark::serialize_data()
+{
+    addSizeRows();
+}
+
+void TSCListBenchmark::serialize()
+{
+    QFETCH(int, count);
+    QFETCH(bool, extendedFormat);
+    QVector<TSCCommand> commands = loadTable(count, extendedFormat).commands();
+    QBENCHMARK {
+        QByteArray data = TSCListWriter::serialize(commands);
+        QVERIFY(!data.isEmpty());
+    }
+}
+
+void TSCListBenchmark::save_data()
+{
+    addSizeRows();
+}
+
+void TSCListBenchmark::save()
+{
+    QFETCH(int, count);
+    QFETCH(bool, extendedFormat);
+    QVector<TSCCommand> commands = loadTable(count, extendedFormat).commands();
+    QString path = dir.filePath("save.txt");
+    QBENCHMARK {
+        QString fail;
+        QVERIFY2(TSCListWriter::saveFile(path, commands, &fail), qPrintable(fail));
+    }
+}
+
+void TSCListBenchmark::sort_data()
+{
+    addSizeRows();
+}
+
+void TSCListBenchmark::sort()
+{
+    QFETCH(int, count);
+    QFETCH(bool, extendedFormat);
+    // generated lists are in random order
+    const TSCCommandTable shuffled = loadTable(count, extendedFormat);
+    QBENCHMARK {
+        TSCCommandTable table = shuffled;
+        table.permute(table.sortedRows());
+    }
+}
+
+void TSCListBenchmark::setCommands_data()
+{
+    addSizeRows();
+}
+
+void TSCListBenchmark::setCommands()
+{
+    QFETCH(int, count);
+    QFETCH(bool, extendedFormat);
+    const TSCCommandTable loaded = loadTable(count, extendedFormat);
+    TSCDocument doc;
+    // resets the model, invalidates the search index (it's rebuilt by the next search) and clears the undo history
+    QBENCHMARK {
+        doc.model()->setCommands(loaded);
+    }
+}
+
+void TSCListBenchmark::batchEdit_data()
+{
+    addSizeRows();
+}
+
+void TSCListBenchmark::batchEdit()
+{
+    QFETCH(int, count);
+    QFETCH(bool, extendedFormat);
+    TSCDocument doc;
+    doc.model()->setCommands(loadTable(count, extendedFormat));
+    // every other row of the first 1000 (at most), like a ctrl-click selection
+    QVector<int> rows;
+    QVector<TSCCommand> cmds;
+    for (int row = 0; row < qMin(count, 1000); row += 2) {
+        rows += row;
+        cmds += doc.commands().at(row);
+        cmds.last().setEndsEvent(!cmds.last().endsEvent());
+    }
+    // one batch edit, then one batch remove and its undo
+    QBENCHMARK {
+        doc.model()->replaceCommands(rows, cmds);
+        doc.model()->removeCommands(rows);
+        doc.history()->undo();
+    }
+}
+
+void TSCListBenchmark::buildIndex_data()
+{
+    addSizeRows();
+}
+
+void TSCListBenchmark::buildIndex()
+{
+    QFETCH(int, count);
+    QFETCH(bool, extendedFormat);
+    // what TSCCommandModel::buildSearchIndex() runs on a worker once a list is loaded
+    const TSCCommandTable loaded = loadTable(count, extendedFormat);
+    QBENCHMARK {
+        TSCCommandIndex::build(loaded.commands());
+    }
+}
+
+void TSCListBenchmark::search_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("extendedFormat");
+    QTest::addColumn<QString>("query");
+    const QStringList queries = { "<", "<MS", "flag", "music", "Command 1" };
+    for (int count : counts) {
+        for (const QString &query : queries)
+            QTest::addRow("%d/%s", count, qPrintable(query)) << count << true << query;
+    }
+}
+
+void TSCListBenchmark::search()
+{
+    QFETCH(int, count);
+    QFETCH(bool, extendedFormat);
+    QFETCH(QString, query);
+    TSCDocument doc;
+    doc.model()->setCommands(loadTable(count, extendedFormat));
+    QBENCHMARK {
+        doc.model()->search(query);
+    }
+}
+
+void TSCListBenchmark::paint_data()
+{
+    QTest::addColumn<bool>("html");
+    QTest::addColumn<bool>("warm");
+    QTest::addRow("CommandDelegate/cold") << false << false;
+    QTest::addRow("CommandDelegate/warm") << false << true;
+    QTest::addRow("HTMLDelegate/cold") << true << false;
+    QTest::addRow("HTMLDelegate/warm") << true << true;
+}
+
+void TSCListBenchmark::paint()
+{
+    QFETCH(bool, html);
+    QFETCH(bool, warm);
+    // about one screenful of rows
+    const int rows = 50;
+    TSCDocument doc;
+    doc.model()->setCommands(loadTable(1000, true));
+    QListView view;
+    view.setModel(doc.model());
+    QImage image(480, 640, QImage::Format_ARGB32_Premultiplied);
+    QScopedPointer<QAbstractItemDelegate> delegate;
+    auto makeDelegate = [&]() {
+        if (html)
+            delegate.reset(new HTMLDelegate);
+        else
+            delegate.reset(new CommandDelegate);
+    };
+    makeDelegate();
+    QBENCHMARK {
+        if (!warm)
+            makeDelegate();
+        QPainter painter(&image);
+        QStyleOptionViewItem option;
+        option.initFrom(&view);
+        option.widget = &view;
+        int y = 0;
+        for (int row = 0; row < rows; row++) {
+            QModelIndex index = doc.model()->index(row);
+            QSize size = delegate->sizeHint(option, index);
+            option.rect = QRect(0, y, image.width(), size.height());
+            delegate->paint(&painter, option, index);
+            y += size.height();
+        }
+    }
+}
+
+QByteArray TSCListBenchmark::pattern(qint64 size)
+{
+    QByteArray data(static_cast<int>(size), '\0');
+    for (int i = 0; i < data.size(); i++)
+        data[i] = static_cast<char>((i * 131 + size) & 0xFF);
+    return data;
+}
+
+QByteArray TSCListBenchmark::transcode(const QByteArray &data, bool decode)
+{
+    QString fail;
+    QString srcPath = dir.filePath("codec_src.bin");
+    QString dstPath = dir.filePath("codec_dst.bin");
+    if (!TSCListWriter::writeFile(srcPath, data, &fail))
+        qFatal("Could not write %s: %s", qPrintable(srcPath), qPrintable(fail));
+    if (!TSCCodec::transcodeFile(srcPath, dstPath, decode, &fail))
+        qFatal("Could not transcode %s: %s", qPrintable(srcPath), qPrintable(fail));
+    QFile dst(dstPath);
+    if (!dst.open(QFile::ReadOnly))
+        qFatal("Could not read %s", qPrintable(dstPath));
+    return dst.readAll();
+}
+
+// not a benchmark, but checks that the SIMD kernels and the chunked file path agree with each other
+void TSCListBenchmark::codecRoundTrip()
+{
+    qInfo("addToAll() kernel: %s", TSCCodec::kernelName());
+    // every tail length of the 128, 32 and 16 byte loops
+    for (int size = 0; size <= 512; size++) {
+        const QByteArray original = pattern(size);
+        QByteArray data = original;
+        TSCCodec::encode(data.data(), data.size());
+        TSCCodec::decode(data.data(), data.size());
+        QVERIFY2(data == original, qPrintable(QString("size %1").arg(size)));
+    }
+
+    // a middle byte of 0 stands for a key of 7
+    QByteArray zero(33, 'a');
+    zero[16] = '\0';
+    QByteArray data = zero;
+    TSCCodec::encode(data.data(), data.size());
+    QCOMPARE(TSCCodec::key(data.constData(), data.size()), static_cast<uchar>(7));
+    QCOMPARE(data.at(0), 'h');
+    QCOMPARE(data.at(16), '\0');
+    TSCCodec::decode(data.data(), data.size());
+    QCOMPARE(data, zero);
+
+    // transcodeFile() goes 1 MiB at a time; the last size puts the middle byte in the second chunk
+    for (qint64 size : { 0, 1, 2, 4097, (3 << 20) + 5 }) {
+        const QByteArray original = pattern(size);
+        QByteArray encoded = original;
+        TSCCodec::encode(encoded.data(), encoded.size());
+        QCOMPARE(transcode(original, false), encoded);
+        QByteArray decoded = encoded;
+        TSCCodec::decode(decoded.data(), decoded.size());
+        QCOMPARE(decoded, original);
+        QCOMPARE(transcode(encoded, true), decoded);
+    }
+}
+
+void TSCListBenchmark::codec_data()
+{
+    QTest::addColumn<bool>("file");
+    QTest::addColumn<int>("size");
+    for (int size : { 64 << 10, 1 << 20, 16 << 20 }) {
+        QTest::addRow("decode/%d", size) << false << size;
+        QTest::addRow("transcodeFile/%d", size) << true << size;
+    }
+}
+
+void TSCListBenchmark::codec()
+{
+    QFETCH(bool, file);
+    QFETCH(int, size);
+    QByteArray data = pattern(size);
+    TSCCodec::encode(data.data(), data.size());
+    if (file) {
+        QString fail;
+        QString srcPath = dir.filePath("codec_bench.tsc");
+        QString dstPath = dir.filePath("codec_bench.txt");
+        QVERIFY2(TSCListWriter::writeFile(srcPath, data, &fail), qPrintable(fail));
+        QBENCHMARK {
+            QVERIFY2(TSCCodec::transcodeFile(srcPath, dstPath, true, &fail), qPrintable(fail));
+        }
+    } else {
+        // the middle byte never changes, so every round shifts by the same key
+        QBENCHMARK {
+            TSCCodec::decode(data.data(), data.size());
+        }
+    }
+}
+
+QTEST_MAIN(TSCListBenchmark)
+
+#include "tsclistbenchmark.moc"
@@ -0,0 +1,78 @@
+#include "tsclistgenerator.h"
+#include "tsccommand.h"
+
+#include <QVector>
+#include <algorithm>
+#include <random>
+
+namespace {
+
+const char codeChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789abcdefghijklmnopqrstuvwxyz";
+const int codeCharCount = sizeof(codeChars) - 1;
+
+// "<" + 3 characters, like real commands, until those run out
+QByteArray makeCode(int i)
+{
+    QByteArray code(TSCCommand::CodeLength, '<');
+    for (int j = TSCCommand::CodeLength - 1; j > 0; j--) {
+        code[j] = codeChars[i % codeCharCount];
+        i /= codeCharCount;
+    }
+    if (i > 0)
+        code[0] = codeChars[(i - 1) % codeCharCount];
+    return code;
+}
+
+const char *const words[] = {
+    "the", "player", "event", "flag", "map", "NPC", "sound", "music", "item", "weapon",
+    "set", "clear", "jump", "to", "if", "wait", "for", "ticks", "and", "face",
+};
+const int wordCount = sizeof(words) / sizeof(*words);
+
+}
+
+QByteArray TSCListGenerator::generate(int count, bool extendedFormat, quint32 seed)
+{
+    std::mt19937 rng(seed);
+    QVector<int> order(count);
+    for (int i = 0; i < count; i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), rng);
+    const QList<QPair<TSCCommand::ParameterType, QString>> &types = TSCCommand::paramTypeNames;
+    QByteArray out;
+    out.reserve(count * 64 + 32);
+    out += extendedFormat ? "[BL_TSC]\t" : "[CE_TSC]\t";
+    out += QByteArray::number(count);
+    out += '\n';
+    for (int i : order) {
+        out += makeCode(i);
+        int paramCount = static_cast<int>(rng() % (TSCCommand::MaxParams + 1));
+        out += '\t';
+        out += static_cast<char>('0' + paramCount);
+        out += '\t';
+        for (int j = 0; j < TSCCommand::MaxParams; j++) {
+            // skip None, which is first
+            out += j < paramCount ? static_cast<char>(types[1 + static_cast<int>(rng() % (types.size() - 1))].first) : '-';
+        }
+        out += "\tCommand ";
+        out += QByteArray::number(i);
+        out += '\t';
+        int descWords = 3 + static_cast<int>(rng() % 12);
+        for (int j = 0; j < descWords; j++) {
+            if (j > 0)
+                out += ' ';
+            out += words[rng() % wordCount];
+        }
+        if (extendedFormat) {
+            out += rng() % 8 == 0 ? "\t1" : "\t0";
+            out += rng() % 8 == 0 ? "\t1" : "\t0";
+            out += rng() % 2 == 0 ? "\t1" : "\t0";
+            for (int j = 0; j < TSCCommand::MaxParams; j++) {
+                out += '\t';
+                out += static_cast<char>('1' + (j < paramCount ? rng() % 4 : 3));
+            }
+        }
+        out += '\n';
+    }
+    return out;
+}
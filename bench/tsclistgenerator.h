@@ -0,0 +1,16 @@
+#ifndef TSCLISTGENERATOR_H
+#define TSCLISTGENERATOR_H
+
+#include <QByteArray>
+
+// Makes up tsc_list.txt files of any size, with unique codes in random order
+// and a realistic mix of parameters, names and descriptions.
+// The same seed always gives the same file.
+
+class TSCListGenerator
+{
+public:
+    static QByteArray generate(int count, bool extendedFormat, quint32 seed = 1);
+};
+
+#endif // TSCLISTGENERATOR_H
@@ -0,0 +1,18 @@
+# Headless command-line version of the list tools, for build pipelines:
+# validating, normalizing/sorting and converting lists, printing stats, and
+# diffing/merging lists by command code.
+# Only needs QtCore, so it runs without a display server.
+
+QT = core concurrent
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = tsclistedit-cli
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../core.pri)
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,360 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QtConcurrent>
+#include "tscdocument.h"
+#include "tscheaderexporter.h"
+#include "tsclistmerge.h"
+#include "tsclistparser.h"
+#include "tsclistwriter.h"
+#include "tscscriptvalidator.h"
+#include "tsctrace.h"
+
+namespace {
+
+// documented in --help, so scripts can rely on them
+enum ExitCode {
+    ExitOk = 0,
+    // a list (or script) has problems, or --check found a list that would change
+    ExitProblems = 1,
+    ExitUsage = 2,
+    // a list couldn't be read or written at all
+    ExitIOError = 3,
+};
+
+enum Command {
+    Validate,
+    Normalize,
+    Convert,
+    Stats,
+    Diff,
+    Merge,
+    Header,
+};
+
+struct Options {
+    Command command;
+    bool sort;
+    bool check;
+    QString scriptDir;
+    QString output;
+    TSCListMerge::Side prefer;
+};
+
+struct FileResult {
+    QString fileName;
+    ExitCode exitCode = ExitOk;
+    // printed to stdout, and to stderr respectively
+    QStringList out;
+    QStringList err;
+    // kept for validating scripts against afterwards
+    QVector<TSCCommand> commands;
+};
+
+QString statsOf(const TSCCommandTable &commands, bool extendedFormat)
+{
+    int paramCounts[TSCCommand::MaxParams + 1] = {};
+    int endsEvent = 0, clearsTextbox = 0, undocumented = 0;
+    // compared as UTF-8, so nothing has to be decoded
+    QSet<QByteArray> descriptions;
+    for (const TSCCommand &cmd : commands.commands()) {
+        paramCounts[cmd.paramCount()]++;
+        if (cmd.endsEvent())
+            endsEvent++;
+        if (cmd.clearsTextbox())
+            clearsTextbox++;
+        if (cmd.descriptionSizeHint() == 0)
+            undocumented++;
+        else
+            descriptions += cmd.descriptionUtf8();
+    }
+    QStringList params;
+    for (int i = 0; i <= TSCCommand::MaxParams; i++)
+        params += QString("%1: %2").arg(i).arg(paramCounts[i]);
+    return QString("%1 commands, %2; ends event: %3, clears textbox: %4; parameters (%5); %6 without a description, %7 distinct descriptions")
+            .arg(commands.size()).arg(extendedFormat ? "[BL_TSC]" : "[CE_TSC]").arg(endsEvent).arg(clearsTextbox)
+            .arg(params.join(", ")).arg(undocumented).arg(descriptions.size());
+}
+
+void exportTrace(const QString &traceFile)
+{
+    QString fail;
+    if (!traceFile.isEmpty() && !TSCTrace::exportChromeTrace(traceFile, &fail))
+        qWarning("Could not write trace to %s: %s", qPrintable(traceFile), qPrintable(fail));
+}
+
+// loads the lists like the editor does (no cache), all at once; false if any of them fails
+bool loadLists(const QStringList &files, QVector<QVector<TSCCommand>> *lists, QTextStream &err)
+{
+    const QVector<TSCDocument::LoadResult> results = QtConcurrent::blockingMapped<QVector<TSCDocument::LoadResult>>(files, [](const QString &fileName) {
+        return TSCDocument::readFile(fileName, false);
+    });
+    bool ok = true;
+    for (int i = 0; i < results.size(); i++) {
+        if (!results[i].ok) {
+            err << QString("%1: error: %2\n").arg(files[i]).arg(results[i].message);
+            ok = false;
+        }
+        lists->append(results[i].commands.commands());
+    }
+    return ok;
+}
+
+ExitCode exportHeader(const Options &options, const QStringList &files, QTextStream &out, QTextStream &err)
+{
+    QVector<QVector<TSCCommand>> lists;
+    if (!loadLists(files, &lists, err))
+        return ExitIOError;
+    QString fail;
+    if (!TSCHeaderExporter::exportFile(options.output, lists[0], files[0], &fail)) {
+        err << QString("%1: error: %2\n").arg(options.output).arg(fail);
+        return ExitIOError;
+    }
+    out << QString("%1: %2 commands\n").arg(options.output).arg(lists[0].size());
+    return ExitOk;
+}
+
+ExitCode diffLists(const QStringList &files, QTextStream &out, QTextStream &err)
+{
+    QVector<QVector<TSCCommand>> lists;
+    if (!loadLists(files, &lists, err))
+        return ExitIOError;
+    const QVector<TSCListMerge::Change> changes = TSCListMerge::compare(lists[0], lists[1]);
+    for (const TSCListMerge::Change &change : changes) {
+        QString code = TSCCommand::codeFromKey(change.codeKey);
+        switch (change.kind) {
+        case TSCListMerge::Change::Added:
+            out << QString("+ %1 (row %2)\n").arg(code).arg(change.toRow + 1);
+            break;
+        case TSCListMerge::Change::Removed:
+            out << QString("- %1 (row %2)\n").arg(code).arg(change.fromRow + 1);
+            break;
+        case TSCListMerge::Change::Changed:
+            out << QString("~ %1: %2 -> %3\n").arg(code)
+                   .arg(TSCListMerge::describe(lists[0][change.fromRow], change.fields))
+                   .arg(TSCListMerge::describe(lists[1][change.toRow], change.fields));
+            break;
+        }
+    }
+    // like diff(1), differences are a non-zero exit
+    return changes.isEmpty() ? ExitOk : ExitProblems;
+}
+
+// usable as a git merge driver: "tsclistedit-cli merge %O %A %B" writes the result over %A
+ExitCode mergeLists(const Options &options, const QStringList &files, QTextStream &out, QTextStream &err)
+{
+    QVector<QVector<TSCCommand>> lists;
+    if (!loadLists(files, &lists, err))
+        return ExitIOError;
+    TSCListMerge::Result result;
+    QString fail;
+    if (!TSCListMerge::merge(lists[0], lists[1], lists[2], &result, &fail, options.prefer)) {
+        err << QString("error: %1\n").arg(fail);
+        return ExitProblems;
+    }
+    for (const TSCListMerge::Conflict &conflict : qAsConst(result.conflicts)) {
+        QString code = TSCCommand::codeFromKey(conflict.codeKey);
+        if (conflict.fields != 0)
+            out << QString("%1: conflict: ours has %2, theirs has %3\n").arg(code)
+                   .arg(TSCListMerge::describe(conflict.ours, conflict.fields))
+                   .arg(TSCListMerge::describe(conflict.theirs, conflict.fields));
+        else
+            out << QString("%1: conflict: %2, kept\n").arg(code).arg(conflict.inOurs ? "changed in ours, removed in theirs" : "removed in ours, changed in theirs");
+    }
+    QString fileName = options.output.isEmpty() ? files[1] : options.output;
+    if (!TSCListWriter::writeFile(fileName, TSCListWriter::serialize(result.commands), &fail)) {
+        err << QString("%1: error: %2\n").arg(fileName).arg(fail);
+        return ExitIOError;
+    }
+    out << QString("%1: merged, %2 change(s) taken from theirs, %3 conflict(s)\n").arg(fileName).arg(result.changes.size()).arg(result.conflicts.size());
+    // the file is always valid, but conflicts still need a look
+    return result.conflicts.isEmpty() ? ExitOk : ExitProblems;
+}
+
+// same rules as loading and saving in the editor: TSCListParser in, TSCListWriter out
+FileResult processFile(const Options &options, const QString &fileName)
+{
+    TSC_TRACE("processFile");
+    FileResult result;
+    result.fileName = fileName;
+    QFile src(fileName);
+    if (!src.open(QFile::ReadOnly)) {
+        result.err += QString("%1: error: %2").arg(fileName).arg(src.errorString());
+        result.exitCode = ExitIOError;
+        return result;
+    }
+    QByteArray data = src.readAll();
+    src.close();
+    bool extendedFormat;
+    uint headerCount;
+    TSCCommandTable commands;
+    QString fail;
+    if (!TSCListParser::parseHeader(data.constData(), data.size(), &extendedFormat, &headerCount, &fail)
+            || !TSCListParser::parse(data, &commands, &fail)) {
+        result.err += QString("%1: error: %2").arg(fileName).arg(fail);
+        result.exitCode = ExitProblems;
+        return result;
+    }
+
+    switch (options.command) {
+    case Validate:
+        result.out += QString("%1: OK, %2 commands").arg(fileName).arg(commands.size());
+        result.commands = commands.commands();
+        break;
+    case Stats:
+        result.out += QString("%1: %2").arg(fileName).arg(statsOf(commands, extendedFormat));
+        break;
+    case Diff:
+    case Merge:
+    case Header:
+        break;
+    case Normalize:
+    case Convert: {
+        if (options.command == Convert && extendedFormat) {
+            result.out += QString("%1: already [BL_TSC]").arg(fileName);
+            break;
+        }
+        if (options.sort)
+            commands.permute(commands.sortedRows());
+        QByteArray normalized = TSCListWriter::serialize(commands.commands());
+        if (normalized == data) {
+            result.out += QString("%1: unchanged").arg(fileName);
+            break;
+        }
+        if (options.check) {
+            result.out += QString("%1: would change").arg(fileName);
+            result.exitCode = ExitProblems;
+            break;
+        }
+        if (!TSCListWriter::writeFile(fileName, normalized, &fail)) {
+            result.err += QString("%1: error: %2").arg(fileName).arg(fail);
+            result.exitCode = ExitIOError;
+            break;
+        }
+        result.out += QString("%1: %2").arg(fileName).arg(options.command == Convert ? "converted to [BL_TSC]" : "normalized");
+        break;
+    }
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setOrganizationName("Leo40Git");
+    app.setApplicationName("TSCListEdit");
+    QString traceFile = qEnvironmentVariable("TSCLISTEDIT_TRACE");
+    TSCTrace::setEnabled(!traceFile.isEmpty());
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+                "Checks and rewrites tsc_list.txt files without starting the editor.\n\n"
+                "Commands:\n"
+                "  validate   parse the lists and report any errors\n"
+                "  normalize  rewrite the lists the way the editor saves them\n"
+                "  convert    rewrite [CE_TSC] lists as [BL_TSC], leaving [BL_TSC] lists alone\n"
+                "  stats      print some numbers about the lists\n"
+                "  diff       compare two lists command by command: diff OLD NEW\n"
+                "  merge      three-way merge by command code: merge BASE OURS THEIRS\n"
+                "             (writes over OURS unless --output is given, so it works as a git merge driver)\n"
+                "  header     write a C++ header with a constexpr lookup table: header LIST --output FILE\n\n"
+                "Exit codes: 0 = fine, 1 = problems found (or --check found changes, diff found\n"
+                "differences, merge had conflicts), "
+                "2 = bad arguments, 3 = a file couldn't be read or written.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "validate, normalize, convert, stats, diff, merge or header");
+    parser.addPositionalArgument("files", "The tsc_list.txt files to work on.", "files...");
+    QCommandLineOption sortOption("sort", "normalize/convert: also sort the commands by code.");
+    QCommandLineOption checkOption("check", "normalize/convert: don't write anything, just fail if a list would change.");
+    QCommandLineOption scriptsOption("scripts", "validate: also check the .tsc scripts in <directory> against each list.", "directory");
+    QCommandLineOption outputOption("output", "merge: write the result to <file> instead of over OURS; header: the file to write.", "file");
+    QCommandLineOption preferOption("prefer", "merge: which side conflicting fields are taken from, ours (default) or theirs.", "side", "ours");
+    parser.addOption(sortOption);
+    parser.addOption(outputOption);
+    parser.addOption(preferOption);
+    parser.addOption(checkOption);
+    parser.addOption(scriptsOption);
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    QStringList args = parser.positionalArguments();
+    const QStringList commandNames = { "validate", "normalize", "convert", "stats", "diff", "merge", "header" };
+    int command = args.isEmpty() ? -1 : commandNames.indexOf(args[0]);
+    if (command < 0 || args.size() < 2) {
+        err << (command < 0 && !args.isEmpty() ? QString("Unknown command \"%1\"\n").arg(args[0]) : QString("Missing command or files\n"));
+        err << parser.helpText();
+        return ExitUsage;
+    }
+    QString prefer = parser.value(preferOption);
+    if (prefer != "ours" && prefer != "theirs") {
+        err << QString("--prefer must be ours or theirs, not \"%1\"\n").arg(prefer);
+        return ExitUsage;
+    }
+    Options options { static_cast<Command>(command), parser.isSet(sortOption), parser.isSet(checkOption), parser.value(scriptsOption),
+                      parser.value(outputOption), prefer == "theirs" ? TSCListMerge::Theirs : TSCListMerge::Ours };
+    QStringList files = args.mid(1);
+    if (options.command == Diff || options.command == Merge || options.command == Header) {
+        int expected = options.command == Diff ? 2 : options.command == Merge ? 3 : 1;
+        if (files.size() != expected) {
+            err << QString("%1 takes exactly %2 file(s)\n").arg(args[0]).arg(expected);
+            return ExitUsage;
+        }
+        if (options.command == Header && options.output.isEmpty()) {
+            err << "header needs --output\n";
+            return ExitUsage;
+        }
+        ExitCode exitCode;
+        if (options.command == Diff)
+            exitCode = diffLists(files, out, err);
+        else if (options.command == Merge)
+            exitCode = mergeLists(options, files, out, err);
+        else
+            exitCode = exportHeader(options, files, out, err);
+        out.flush();
+        exportTrace(traceFile);
+        return exitCode;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    // every list is independent, so they're all done at once; results still come back in order
+    const QVector<FileResult> results = QtConcurrent::blockingMapped<QVector<FileResult>>(files, [&options](const QString &fileName) {
+        return processFile(options, fileName);
+    });
+
+    ExitCode exitCode = ExitOk;
+    QStringList scripts;
+    if (options.command == Validate && !options.scriptDir.isEmpty())
+        scripts = TSCScriptValidator::findScripts(options.scriptDir);
+    for (const FileResult &result : results) {
+        for (const QString &line : result.out)
+            out << line << '\n';
+        for (const QString &line : result.err)
+            err << line << '\n';
+        exitCode = qMax(exitCode, result.exitCode);
+        if (result.exitCode != ExitOk || scripts.isEmpty())
+            continue;
+        out.flush();
+        TSCScriptValidator::FileValidator validator { TSCScriptValidator(result.commands) };
+        const QList<QVector<TSCScriptIssue>> issues = QtConcurrent::blockingMapped<QList<QVector<TSCScriptIssue>>>(scripts, validator);
+        int issueCount = 0;
+        for (const QVector<TSCScriptIssue> &scriptIssues : issues) {
+            for (const TSCScriptIssue &issue : scriptIssues)
+                out << QString("%1:%2:%3: %4\n").arg(issue.fileName).arg(issue.line).arg(issue.column).arg(issue.message);
+            issueCount += scriptIssues.size();
+        }
+        out << QString("%1: checked %2 scripts, %3 issues\n").arg(result.fileName).arg(scripts.size()).arg(issueCount);
+        if (issueCount > 0)
+            exitCode = qMax(exitCode, ExitProblems);
+    }
+    out << QString("%1 lists in %2 ms\n").arg(files.size()).arg(timer.elapsed());
+    out.flush();
+    exportTrace(traceFile);
+    return exitCode;
+}
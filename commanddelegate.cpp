@@ -0,0 +1,146 @@
+#include "commanddelegate.h"
+#include "tsccommandmodel.h"
+
+#include <QPainter>
+#include <QApplication>
+#include <QHBoxLayout>
+#include <QLineEdit>
+#include <QFontDatabase>
+#include <QtMath>
+#include "tsctrace.h"
+
+void CommandDelegate::updateFonts(const QFont &font) const
+{
+    if (font.key() == cachedFontKey)
+        return;
+    // cached layouts are only valid for the font they were made with
+    lineCache.clear();
+    cachedFontKey = font.key();
+    codeFont = font;
+    codeFont.setFamily(QFontDatabase::systemFont(QFontDatabase::FixedFont).family());
+    codeFont.setStyleHint(QFont::Monospace);
+}
+
+const CommandDelegate::Line *CommandDelegate::line(const QModelIndex &index, const QFont &font) const
+{
+    updateFonts(font);
+    QString code = index.data(TSCCommandModel::CodeRole).toString();
+    QString name = index.data(TSCCommandModel::NameRole).toString();
+    QString key = code + name;
+    Line *line = lineCache.object(key);
+    if (!line) {
+        line = new Line;
+        line->code.setText(code);
+        line->code.setTextFormat(Qt::PlainText);
+        line->code.prepare(QTransform(), codeFont);
+        line->rest.setText(QString(" - %1").arg(name));
+        line->rest.setTextFormat(Qt::PlainText);
+        line->rest.prepare(QTransform(), font);
+        line->codeWidth = qCeil(line->code.size().width());
+        line->width = line->codeWidth + qCeil(line->rest.size().width());
+        lineCache.insert(key, line);
+    }
+    return line;
+}
+
+void CommandDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    TSC_TRACE("CommandDelegate::paint");
+    QStyleOptionViewItem options = option;
+    initStyleOption(&options, index);
+    options.text = QString();
+
+    const QWidget *widget = options.widget;
+    QStyle *style = widget ? widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_ItemViewItem, &options, painter, widget);
+
+    const Line *l = line(index, options.font);
+    QRect textRect = style->subElementRect(QStyle::SE_ItemViewItemText, &options, widget);
+    QPalette::ColorGroup cg = QPalette::Disabled;
+    if (options.state & QStyle::State_Enabled)
+        cg = options.state & QStyle::State_Active ? QPalette::Normal : QPalette::Inactive;
+    QPalette::ColorRole role = options.state & QStyle::State_Selected ? QPalette::HighlightedText : QPalette::Text;
+
+    painter->save();
+    painter->setClipRect(textRect);
+    painter->setPen(options.palette.color(cg, role));
+    int codeY = textRect.top() + (textRect.height() - qCeil(l->code.size().height())) / 2;
+    int restY = textRect.top() + (textRect.height() - qCeil(l->rest.size().height())) / 2;
+    painter->setFont(codeFont);
+    painter->drawStaticText(textRect.left(), codeY, l->code);
+    painter->setFont(options.font);
+    painter->drawStaticText(textRect.left() + l->codeWidth, restY, l->rest);
+    painter->restore();
+}
+
+QSize CommandDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    TSC_TRACE("CommandDelegate::sizeHint");
+    updateFonts(option.font);
+    int margin = (option.widget ? option.widget->style() : QApplication::style())->pixelMetric(QStyle::PM_FocusFrameHMargin, nullptr, option.widget) + 1;
+    int height = qMax(QFontMetrics(option.font).height(), QFontMetrics(codeFont).height());
+    return QSize(line(index, option.font)->width + 2 * margin, height + 2);
+}
+
+QLineEdit *CommandDelegate::codeEdit(QWidget *editor)
+{
+    return editor->findChild<QLineEdit *>("leCode");
+}
+
+QLineEdit *CommandDelegate::nameEdit(QWidget *editor)
+{
+    return editor->findChild<QLineEdit *>("leName");
+}
+
+QWidget *CommandDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    (void)index;
+    updateFonts(option.font);
+    QWidget *editor = new QWidget(parent);
+    editor->setAutoFillBackground(true);
+    QHBoxLayout *layout = new QHBoxLayout(editor);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->setSpacing(2);
+    QLineEdit *leCode = new QLineEdit(editor);
+    leCode->setObjectName("leCode");
+    leCode->setFont(codeFont);
+    // same rules as CommandEditDialog's code field
+    leCode->setInputMask("\\<XXX");
+    leCode->setFixedWidth(QFontMetrics(codeFont).horizontalAdvance(QString(TSCCommand::CodeLength + 1, 'W')));
+    QLineEdit *leName = new QLineEdit(editor);
+    leName->setObjectName("leName");
+    layout->addWidget(leCode);
+    layout->addWidget(leName);
+    // Return, Escape and focus leaving the editor are handled by the event filter on editor,
+    // which the line edits pass their unhandled keys up to
+    editor->setFocusProxy(leName);
+    return editor;
+}
+
+void CommandDelegate::setEditorData(QWidget *editor, const QModelIndex &index) const
+{
+    codeEdit(editor)->setText(index.data(TSCCommandModel::CodeRole).toString());
+    QLineEdit *leName = nameEdit(editor);
+    leName->setText(index.data(TSCCommandModel::NameRole).toString());
+    leName->selectAll();
+}
+
+void CommandDelegate::setModelData(QWidget *editor, QAbstractItemModel *model, const QModelIndex &index) const
+{
+    QString code = codeEdit(editor)->text();
+    QString problem = TSCCommand::codeProblem(code);
+    if (!problem.isEmpty()) {
+        emit editRejected(problem);
+        return;
+    }
+    if (!(model->flags(index) & Qt::ItemIsEditable)) {
+        emit editRejected("The list can't be edited while it's loading.");
+        return;
+    }
+    QMap<int, QVariant> roles;
+    roles.insert(TSCCommandModel::CodeRole, code);
+    roles.insert(TSCCommandModel::NameRole, nameEdit(editor)->text());
+    // the code is fine by itself, so the only thing left to turn it down for is being taken
+    if (!model->setItemData(index, roles))
+        emit editRejected(QString("Code %1 is already in use.").arg(code));
+}
@@ -0,0 +1,53 @@
+#ifndef COMMANDDELEGATE_H
+#define COMMANDDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QStaticText>
+#include <QCache>
+
+// Paints TSCCommandModel rows as "<code> - name" without going through HTML.
+// The code and name are kept as pre-laid-out QStaticTexts, cached by row
+// content and font, and every row has the same height, so views can use
+// QListView::setUniformItemSizes() and skip per-row size queries.
+// Editing a row in place gives a code and a name field, for quick changes
+// that don't need the whole CommandEditDialog.
+
+class QLineEdit;
+
+class CommandDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    using QStyledItemDelegate::QStyledItemDelegate;
+
+    QWidget *createEditor(QWidget *parent, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    void setEditorData(QWidget *editor, const QModelIndex &index) const override;
+    void setModelData(QWidget *editor, QAbstractItemModel *model, const QModelIndex &index) const override;
+
+signals:
+    // an in-place edit couldn't be applied
+    void editRejected(const QString &message) const;
+
+protected:
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+private:
+    struct Line {
+        QStaticText code;
+        QStaticText rest;
+        int codeWidth;
+        int width;
+    };
+
+    mutable QCache<QString, Line> lineCache { 4096 };
+    mutable QString cachedFontKey;
+    mutable QFont codeFont;
+
+    void updateFonts(const QFont &font) const;
+    const Line *line(const QModelIndex &index, const QFont &font) const;
+    static QLineEdit *codeEdit(QWidget *editor);
+    static QLineEdit *nameEdit(QWidget *editor);
+};
+
+#endif // COMMANDDELEGATE_H
@@ -1,13 +1,30 @@
 #include "commandeditdialog.h"
 #include "ui_commandeditdialog.h"
 
-#include <QMetaEnum>
-#include <QStringListModel>
+#include <QApplication>
+#include <QMessageBox>
+#include <QStandardItemModel>
+#include "tsctrace.h"
 
-CommandEditDialog::CommandEditDialog(TSCCommandPtr cmd, QWidget *parent) :
+QAbstractItemModel *CommandEditDialog::paramTypeModel()
+{
+    static QStandardItemModel *model = nullptr;
+    if (!model) {
+        model = new QStandardItemModel(qApp);
+        for (const QPair<TSCCommand::ParameterType, QString> &type : TSCCommand::paramTypeNames) {
+            QStandardItem *item = new QStandardItem(type.second);
+            item->setData(type.first, Qt::UserRole);
+            model->appendRow(item);
+        }
+    }
+    return model;
+}
+
+CommandEditDialog::CommandEditDialog(QWidget *parent) :
     QDialog(parent),
     ui(new Ui::CommandEditDialog)
 {
+    TSC_TRACE("CommandEditDialog::CommandEditDialog");
     ui->setupUi(this);
 
     paramStuff += QPair<QComboBox*, QSpinBox*>(ui->cbParamType1, ui->sbParamLen1);
@@ -17,28 +34,8 @@ CommandEditDialog::CommandEditDialog(TSCCommandPtr cmd, QWidget *parent) :
 
     ui->leCode->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
 
-    QListIterator<QPair<TSCCommand::ParameterType, QString>> it(TSCCommand::paramTypeNames);
-    for (int i = 0; i < paramStuff.size(); i++) {
-        paramStuff[i].first->clear();
-        it.toFront();
-        while (it.hasNext()) {
-            const QPair<TSCCommand::ParameterType, QString> &next = it.next();
-            paramStuff[i].first->addItem(next.second, next.first);
-        }
-    }
-
-    ui->leCode->setText(cmd->code);
-    ui->leName->setText(cmd->name);
-    ui->teDescription->setPlainText(cmd->description);
-
-    for (int i = 0; i < paramStuff.size(); i++) {
-        paramStuff[i].first->setCurrentIndex(paramStuff[i].first->findData(cmd->params[i].first));
-        paramStuff[i].second->setValue(cmd->params[i].second);
-    }
-
-    ui->cbEndsEvent->setChecked(cmd->endsEvent);
-    ui->cbClearsTextbox->setChecked(cmd->clearsTextbox);
-    ui->cbParamsAreSeparated->setChecked(cmd->paramsAreSeparated);
+    for (int i = 0; i < paramStuff.size(); i++)
+        paramStuff[i].first->setModel(paramTypeModel());
 }
 
 CommandEditDialog::~CommandEditDialog()
@@ -46,6 +43,24 @@ CommandEditDialog::~CommandEditDialog()
     delete ui;
 }
 
+void CommandEditDialog::setCommand(const TSCCommand &cmd)
+{
+    TSC_TRACE("CommandEditDialog::setCommand");
+    ui->leCode->setText(cmd.code());
+    ui->leName->setText(cmd.name);
+    ui->teDescription->setPlainText(cmd.description());
+
+    for (int i = 0; i < paramStuff.size(); i++) {
+        paramStuff[i].first->setCurrentIndex(paramStuff[i].first->findData(cmd.params[i].type));
+        paramStuff[i].second->setValue(cmd.params[i].length);
+    }
+
+    ui->cbEndsEvent->setChecked(cmd.endsEvent());
+    ui->cbClearsTextbox->setChecked(cmd.clearsTextbox());
+    ui->cbParamsAreSeparated->setChecked(cmd.paramsAreSeparated());
+    ui->leCode->setFocus();
+}
+
 void CommandEditDialog::on_btnCancel_clicked()
 {
     reject();
@@ -53,20 +68,26 @@ void CommandEditDialog::on_btnCancel_clicked()
 
 void CommandEditDialog::on_btnOK_clicked()
 {
-    TSCCommandPtr newCmd = TSCCommandPtr(new TSCCommand);
+    QString problem = TSCCommand::codeProblem(ui->leCode->text());
+    if (!problem.isEmpty()) {
+        QMessageBox::critical(this, "Invalid code", problem);
+        return;
+    }
+
+    TSCCommand newCmd;
 
-    newCmd->code = ui->leCode->text();
-    newCmd->name = ui->leName->text();
-    newCmd->description = ui->teDescription->toPlainText();
+    newCmd.setCode(ui->leCode->text());
+    newCmd.name = ui->leName->text();
+    newCmd.setDescription(ui->teDescription->toPlainText());
 
     for (int i = 0; i < paramStuff.size(); i++) {
-        newCmd->params[i].first = static_cast<TSCCommand::ParameterType>(paramStuff[i].first->currentData().toUInt());
-        newCmd->params[i].second = paramStuff[i].second->value();
+        newCmd.params[i].type = static_cast<TSCCommand::ParameterType>(paramStuff[i].first->currentData().toUInt());
+        newCmd.params[i].length = static_cast<quint8>(paramStuff[i].second->value());
     }
 
-    newCmd->endsEvent = ui->cbEndsEvent->isChecked();
-    newCmd->clearsTextbox = ui->cbClearsTextbox->isChecked();
-    newCmd->paramsAreSeparated = ui->cbParamsAreSeparated->isChecked();
+    newCmd.setEndsEvent(ui->cbEndsEvent->isChecked());
+    newCmd.setClearsTextbox(ui->cbClearsTextbox->isChecked());
+    newCmd.setParamsAreSeparated(ui->cbParamsAreSeparated->isChecked());
 
     emit commandReady(this, newCmd);
 }
@@ -10,16 +10,26 @@ namespace Ui {
 class CommandEditDialog;
 }
 
+// Edits every property of a single command.
+// Meant to be kept around and reused through setCommand(), so the form is
+// only set up once; the parameter type lists all share one model.
+
+class QAbstractItemModel;
+
 class CommandEditDialog : public QDialog
 {
     Q_OBJECT
 
 public:
-    explicit CommandEditDialog(TSCCommandPtr cmd, QWidget *parent = nullptr);
+    explicit CommandEditDialog(QWidget *parent = nullptr);
     ~CommandEditDialog();
 
+    void setCommand(const TSCCommand &cmd);
+    // the parameter types and their names, as UserRole and DisplayRole
+    static QAbstractItemModel *paramTypeModel();
+
 signals:
-    void commandReady(CommandEditDialog *ced, TSCCommandPtr newCmd);
+    void commandReady(CommandEditDialog *ced, const TSCCommand &newCmd);
 
 private slots:
     void on_btnCancel_clicked();
@@ -0,0 +1,47 @@
+# Everything that works without a MainWindow: the command table and models,
+# list reading/writing and script validation.
+# Shared by the app (TSCListEdit.pro) and the benchmarks (bench/bench.pro).
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/tsccodec.cpp \
+    $$PWD/tsccommand.cpp \
+    $$PWD/tsccommandfiltermodel.cpp \
+    $$PWD/tsccommandindex.cpp \
+    $$PWD/tsccommandmodel.cpp \
+    $$PWD/tsccommandsorter.cpp \
+    $$PWD/tsccommandtable.cpp \
+    $$PWD/tscdocument.cpp \
+    $$PWD/tscheaderexporter.cpp \
+    $$PWD/tsclistcache.cpp \
+    $$PWD/tsclistdiff.cpp \
+    $$PWD/tsclistmerge.cpp \
+    $$PWD/tsclistparser.cpp \
+    $$PWD/tsclistwriter.cpp \
+    $$PWD/tscscriptvalidator.cpp \
+    $$PWD/tscstringpool.cpp \
+    $$PWD/tsctextbuffer.cpp \
+    $$PWD/tsctrace.cpp \
+    $$PWD/tscundohistory.cpp
+
+HEADERS += \
+    $$PWD/tsccodec.h \
+    $$PWD/tsccommand.h \
+    $$PWD/tsccommandfiltermodel.h \
+    $$PWD/tsccommandindex.h \
+    $$PWD/tsccommandmodel.h \
+    $$PWD/tsccommandsorter.h \
+    $$PWD/tsccommandtable.h \
+    $$PWD/tscdocument.h \
+    $$PWD/tscheaderexporter.h \
+    $$PWD/tsclistcache.h \
+    $$PWD/tsclistdiff.h \
+    $$PWD/tsclistmerge.h \
+    $$PWD/tsclistparser.h \
+    $$PWD/tsclistwriter.h \
+    $$PWD/tscscriptvalidator.h \
+    $$PWD/tscstringpool.h \
+    $$PWD/tsctextbuffer.h \
+    $$PWD/tsctrace.h \
+    $$PWD/tscundohistory.h
@@ -5,11 +5,30 @@
 #include <QAbstractTextDocumentLayout>
 #include <QApplication>
 #include <QDebug>
+#include "tsctrace.h"
 
 // https://stackoverflow.com/a/1956781
 
+QTextDocument *HTMLDelegate::document(const QString &html, const QFont &font, int textWidth) const
+{
+    QString key = QString("%1\n%2\n%3").arg(textWidth).arg(font.key()).arg(html);
+    QTextDocument *doc = docCache.object(key);
+    if (!doc) {
+        doc = new QTextDocument;
+        doc->setDefaultFont(font);
+        doc->setHtml(html);
+        if (textWidth >= 0)
+            doc->setTextWidth(textWidth);
+        // force layout now, so the cached copy is ready to draw
+        doc->documentLayout()->documentSize();
+        docCache.insert(key, doc);
+    }
+    return doc;
+}
+
 void HTMLDelegate::paint(QPainter* painter, const QStyleOptionViewItem & option, const QModelIndex &index) const
 {
+    TSC_TRACE("HTMLDelegate::paint");
     QStyleOptionViewItem options = option;
     if (options.text.isNull())
         options.text = index.data().toString();
@@ -17,8 +36,7 @@ void HTMLDelegate::paint(QPainter* painter, const QStyleOptionViewItem & option,
 
     painter->save();
 
-    QTextDocument doc;
-    doc.setHtml(options.text);
+    QTextDocument *doc = document(options.text, options.font, -1);
 
     options.text = "";
     options.widget->style()->drawControl(QStyle::CE_ItemViewItem, &options, painter);
@@ -34,19 +52,17 @@ void HTMLDelegate::paint(QPainter* painter, const QStyleOptionViewItem & option,
     QAbstractTextDocumentLayout::PaintContext ctx;
     ctx.palette = options.widget->style()->standardPalette();
     ctx.clip = clip;
-    doc.documentLayout()->draw(painter, ctx);
+    doc->documentLayout()->draw(painter, ctx);
 
     painter->restore();
 }
 
 QSize HTMLDelegate::sizeHint(const QStyleOptionViewItem& option, const QModelIndex &index) const
 {
-
+    TSC_TRACE("HTMLDelegate::sizeHint");
     QStyleOptionViewItem options = option;
     initStyleOption(&options, index);
 
-    QTextDocument doc;
-    doc.setHtml(options.text);
-    doc.setTextWidth(options.rect.width());
-    return QSize(static_cast<int>(doc.idealWidth()), static_cast<int>(doc.size().height()));
+    QTextDocument *doc = document(options.text, options.font, options.rect.width());
+    return QSize(static_cast<int>(doc->idealWidth()), static_cast<int>(doc->size().height()));
 }
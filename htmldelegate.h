@@ -2,14 +2,27 @@
 #define HTMLDELEGATE_H
 
 #include <QStyledItemDelegate>
+#include <QCache>
+
+class QTextDocument;
 
 // https://stackoverflow.com/a/1956781
+// Laid out documents are cached by HTML, font and width, so repainting and
+// relayouting rows doesn't re-parse the same HTML over and over.
 
 class HTMLDelegate : public QStyledItemDelegate
 {
+public:
+    using QStyledItemDelegate::QStyledItemDelegate;
+
 protected:
     void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
     QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+private:
+    mutable QCache<QString, QTextDocument> docCache { 1024 };
+
+    QTextDocument *document(const QString &html, const QFont &font, int textWidth) const;
 };
 
 #endif // HTMLDELEGATE_H
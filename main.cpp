@@ -1,11 +1,21 @@
 #include "mainwindow.h"
 
 #include <QApplication>
+#include "tsctrace.h"
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+    a.setOrganizationName("Leo40Git");
+    a.setApplicationName("TSCListEdit");
+    // TSCLISTEDIT_TRACE=<file> records from startup and writes the trace there on exit
+    QString traceFile = qEnvironmentVariable("TSCLISTEDIT_TRACE");
+    TSCTrace::setEnabled(!traceFile.isEmpty());
     MainWindow w;
     w.show();
-    return a.exec();
+    int ret = a.exec();
+    QString fail;
+    if (!traceFile.isEmpty() && !TSCTrace::exportChromeTrace(traceFile, &fail))
+        qWarning("Could not write trace to %s: %s", qPrintable(traceFile), qPrintable(fail));
+    return ret;
 }
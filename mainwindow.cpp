@@ -4,15 +4,68 @@
 #include <QMessageBox>
 #include <QCloseEvent>
 #include <QFileDialog>
-#include <QTextStream>
-#include <QMetaEnum>
-#include "htmldelegate.h"
+#include <QStatusBar>
+#include <QSettings>
+#include <QTabBar>
+#include <QTimer>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QApplication>
+#include <QActionGroup>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <algorithm>
+#include "batcheditdialog.h"
+#include "commanddelegate.h"
+#include "mergedialog.h"
+#include "tscheaderexporter.h"
+#include "tsclistwriter.h"
+#include "tscscriptvalidator.h"
+#include "scriptvalidationdialog.h"
+#include "tsctrace.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
+    , doc(nullptr)
+    , mergeRunning(false)
+    , commandEditor(nullptr)
     , ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
+    tabDocs = new QTabBar(this);
+    tabDocs->setTabsClosable(true);
+    tabDocs->setExpanding(false);
+    tabDocs->setDocumentMode(true);
+    ui->gridLayout->addWidget(tabDocs, 0, 0, 1, 4);
+    connect(tabDocs, &QTabBar::currentChanged, this, &MainWindow::currentDocumentChanged);
+    connect(tabDocs, &QTabBar::tabCloseRequested, this, &MainWindow::closeFile);
+    CommandDelegate *delegate = new CommandDelegate(this);
+    connect(delegate, &CommandDelegate::editRejected, this, [this](const QString &message) {
+        statusBar()->showMessage(message, 5000);
+    });
+    ui->lvCmds->setItemDelegate(delegate);
+    ui->lvCmds->setUniformItemSizes(true);
+    fileWatcher = new QFileSystemWatcher(this);
+    connect(fileWatcher, &QFileSystemWatcher::fileChanged, this, &MainWindow::fileChanged);
+    reloadTimer = new QTimer(this);
+    reloadTimer->setSingleShot(true);
+    reloadTimer->setInterval(300);
+    connect(reloadTimer, &QTimer::timeout, this, &MainWindow::reloadChangedFiles);
+    sortActions = new QActionGroup(this);
+    ui->actionSortFileOrder->setActionGroup(sortActions);
+    ui->actionSortCode->setActionGroup(sortActions);
+    ui->actionSortCode->setData(TSCCommandSorter::Code);
+    ui->actionSortName->setActionGroup(sortActions);
+    ui->actionSortName->setData(TSCCommandSorter::Name);
+    ui->actionSortParamCount->setActionGroup(sortActions);
+    ui->actionSortParamCount->setData(TSCCommandSorter::ParamCount);
+    ui->actionSortEndsEvent->setActionGroup(sortActions);
+    ui->actionSortEndsEvent->setData(TSCCommandSorter::EndsEvent);
+    ui->actionSortFileOrder->setChecked(true);
+    connect(sortActions, &QActionGroup::triggered, this, &MainWindow::viewSortChanged);
+    connect(ui->actionSortDescending, &QAction::triggered, this, &MainWindow::viewSortChanged);
+    ui->actionUseCache->setChecked(QSettings().value("useCache", true).toBool());
+    ui->actionRecordTrace->setChecked(TSCTrace::isEnabled());
     newFile();
 }
 
@@ -23,266 +76,444 @@ MainWindow::~MainWindow()
 
 void MainWindow::newFile()
 {
-    fileLoaded = true;
-    commands.clear();
-    lastSaveLocation = nullptr;
-    unsavedMods = false;
-    updateWidgetStates();
+    addDocument(new TSCDocument(this));
 }
 
-static const QStringList cmdParts = {
-    "Code",
-    "Parameter count",
-    "Parameter types",
-    "Name",
-    "Description",
-};
-
-static const QStringList cmdPartsExtended = {
-    "'Ends event' flag",
-    "'Clears textbox' flag",
-    "'Parameters are separated' flag",
-    "Parameter 1 length",
-    "Parameter 2 length",
-    "Parameter 3 length",
-    "Parameter 4 length",
-};
-
-bool MainWindow::loadFile(QFile *src, QString *fail)
-{
-    if (!src->open(QFile::ReadOnly)) {
-        *fail = "Could not open file for reading";
-        return false;
+void MainWindow::loadFile(const QString &fileName)
+{
+    // already open? just switch to it
+    for (int i = 0; i < documents.size(); i++) {
+        if (documents[i]->fileName() == fileName) {
+            tabDocs->setCurrentIndex(i);
+            return;
+        }
     }
-    QTextStream ts(src);
-    QString line;
-    // look for header
-    bool ok;
-    bool gotHeader = false;
-    bool extendedFormat;
-    uint cmdCount;
-    QRegExp reHeader("\\[(CE|BL)_TSC\\]\\s+(\\d+)");
-    while (ts.readLineInto(&line)) {
-        if (reHeader.exactMatch(line)) {
-            extendedFormat = QString("BL").compare(reHeader.cap(1)) == 0;
-            cmdCount = reHeader.cap(2).toUInt(&ok);
-            if (!ok) {
-                *fail = QString("Couldn't read command count (\"%1\") in header").arg(reHeader.cap(2));
-                src->close();
+    bool useCache = ui->actionUseCache->isChecked();
+    TSCDocument *newDoc = new TSCDocument(this);
+    newDoc->setFileName(fileName);
+    newDoc->beginLoading();
+    PendingLoad load { newDoc, doc, std::make_shared<std::atomic<bool>>(false), new QFutureWatcher<TSCDocument::LoadResult>(this) };
+    pendingLoads += load;
+    addDocument(newDoc);
+    connect(load.watcher, &QFutureWatcherBase::finished, this, [this, newDoc]() {
+        loadFinished(newDoc);
+    });
+    std::shared_ptr<std::atomic<bool>> cancelled = load.cancelled;
+    load.watcher->setFuture(QtConcurrent::run([this, newDoc, fileName, useCache, cancelled]() {
+        return TSCDocument::readFile(fileName, useCache, [this, newDoc, cancelled](const QVector<TSCCommand> &batch, qint64 bytesDone, qint64 bytesTotal) {
+            if (*cancelled)
                 return false;
-            }
-            gotHeader = true;
+            // hand the rows over to the GUI thread as they come in; they arrive before the watcher finishes
+            QMetaObject::invokeMethod(this, [this, newDoc, batch, bytesDone, bytesTotal]() {
+                loadProgress(newDoc, batch, bytesDone, bytesTotal);
+            }, Qt::QueuedConnection);
+            return true;
+        });
+    }));
+    statusBar()->showMessage(QString("Loading \"%1\"...").arg(fileName));
+}
+
+void MainWindow::loadProgress(TSCDocument *target, const QVector<TSCCommand> &batch, qint64 bytesDone, qint64 bytesTotal)
+{
+    for (const PendingLoad &load : qAsConst(pendingLoads)) {
+        if (load.doc != target)
+            continue;
+        if (*load.cancelled)
+            return;
+        target->appendLoaded(batch);
+        int percent = bytesTotal > 0 ? static_cast<int>(bytesDone * 100 / bytesTotal) : 100;
+        statusBar()->showMessage(QString("Loading \"%1\"... %2% (%3 commands)").arg(target->fileName()).arg(percent).arg(target->commands().size()));
+        return;
+    }
+}
+
+void MainWindow::loadFinished(TSCDocument *target)
+{
+    PendingLoad load;
+    for (int i = 0; i < pendingLoads.size(); i++) {
+        if (pendingLoads[i].doc == target) {
+            load = pendingLoads.takeAt(i);
             break;
         }
     }
-    if (!gotHeader) {
-        *fail = "Could not find [CE_TSC]/[BL_TSC] header";
-        src->close();
-        return false;
+    TSCDocument::LoadResult result = load.watcher->result();
+    load.watcher->deleteLater();
+    QString fileName = target->fileName();
+    QString status = result.message;
+    if (*load.cancelled) {
+        discardDocument(target, load.previous);
+        status = QString("Cancelled loading \"%1\"").arg(fileName);
+    } else if (result.ok) {
+        target->finishLoading(result.commands);
+        target->setDiskHash(result.contentHash);
+    } else {
+        discardDocument(target, load.previous);
+        loadErrors += QString("%1:\n%2").arg(fileName).arg(result.message);
+        status = QString("Could not load \"%1\"").arg(fileName);
     }
-    // setup some misc stuff
-    QStringList codes;
-    int partCount = cmdParts.size();
-    QStringList partNames;
-    partNames += cmdParts;
-    if (extendedFormat) {
-        partCount += cmdPartsExtended.size();
-        partNames += cmdPartsExtended;
-    }
-    QMetaEnum paramTypeMeta = QMetaEnum::fromType<TSCCommand::ParameterType>();
-    // start reading commands
-    commands.clear();
-    commands.reserve(cmdCount);
-    TSCCommandPtr newCmd;
-    for (uint i = 0; i < cmdCount; i++) {
-        if (ts.atEnd()) {
-            *fail = QString("Incorrect command count; claims there are %1 commands, but only has %2").arg(cmdCount).arg(i);
-            src->close();
-            return false;
-        }
-        newCmd = TSCCommandPtr(new TSCCommand);
-        ts.readLineInto(&line);
-        QStringList parts = line.split('\t');
-        if (parts.size() < partCount) {
-            QString cmdId = QString("#%1").arg(i + 1);
-            if (parts.size() >= 1)
-                cmdId = parts[0];
-            *fail = QString("Command %1 has missing parts: %2").arg(cmdId).arg(partNames.mid(parts.size()).join(", "));
-            src->close();
-            return false;
-        }
-        newCmd->code = parts[0];
-        int conflict;
-        if ((conflict = codes.indexOf(newCmd->code)) < 0)
-            codes += newCmd->code;
-        else {
-            *fail = QString("Commands #%1 and #%2 have same code %3").arg(conflict + 1).arg(i + 1).arg(newCmd->code);
-            src->close();
-            return false;
-        }
-        uint paramCount = parts[1].toUInt(&ok);
-        if (!ok) {
-            *fail = QString("Command %1 has unparsable number %2 in part %3").arg(newCmd->code).arg(parts[1]).arg(partNames[1]);
-            src->close();
+    if (!pendingLoads.isEmpty())
+        status += QString(" (%1 more file(s) loading)").arg(pendingLoads.size());
+    statusBar()->showMessage(status, 5000);
+    updateWidgetStates();
+    updateWatchedFiles();
+    // report errors all at once, instead of interrupting the other loads
+    if (pendingLoads.isEmpty() && !loadErrors.isEmpty()) {
+        QString fail = loadErrors.join("\n\n");
+        loadErrors.clear();
+        QMessageBox::critical(this, "Error while loading file", QString("Could not load TSC file:\n%1").arg(fail));
+    }
+}
+
+void MainWindow::cancelLoad(TSCDocument *target)
+{
+    // loadFinished() cleans up, once the worker notices
+    for (const PendingLoad &load : qAsConst(pendingLoads)) {
+        if (!target || load.doc == target)
+            *load.cancelled = true;
+    }
+}
+
+void MainWindow::discardDocument(TSCDocument *target, TSCDocument *switchTo)
+{
+    int index = documents.indexOf(target);
+    bool wasCurrent = target == doc;
+    documents.removeAt(index);
+    tabDocs->removeTab(index);
+    target->deleteLater();
+    // go back to whatever was open before, untouched
+    if (wasCurrent && documents.contains(switchTo))
+        tabDocs->setCurrentIndex(documents.indexOf(switchTo));
+}
+
+bool MainWindow::saveFile(TSCDocument *target, bool saveAs)
+{
+    QString fileName = target->fileName();
+    if (saveAs || fileName.isEmpty()) {
+        // the document only takes the new name once it's actually been written there, see saveFinished()
+        fileName = QFileDialog::getSaveFileName(this, "Save TSC list", fileName, "TSC list files (*.txt)");
+        if (fileName.isNull())
             return false;
+    }
+    // saves of the same document go to disk in order, without holding up this thread
+    QFuture<SaveResult> previous;
+    for (const PendingSave &save : qAsConst(pendingSaves)) {
+        if (save.doc == target)
+            previous = save.watcher->future();
+    }
+    // the vector is implicitly shared, so this is a cheap but consistent snapshot
+    QVector<TSCCommand> snapshot = target->commands().commands();
+    QFutureWatcher<SaveResult> *watcher = new QFutureWatcher<SaveResult>(this);
+    pendingSaves += PendingSave { target, fileName, watcher };
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() {
+        saveFinished(watcher);
+    });
+    watcher->setFuture(QtConcurrent::run([previous, snapshot, fileName]() mutable {
+        previous.waitForFinished();
+        SaveResult result;
+        result.contentHash = 0;
+        result.ok = TSCListWriter::saveFile(fileName, snapshot, &result.message, &result.contentHash);
+        return result;
+    }));
+    // edits made while saving will set this again
+    target->setUnsavedMods(false);
+    statusBar()->showMessage(QString("Saving to \"%1\"...").arg(fileName));
+    updateWidgetStates();
+    return true;
+}
+
+void MainWindow::saveFinished(QFutureWatcher<SaveResult> *watcher)
+{
+    // waitForSaves() may have reported this one already
+    PendingSave save;
+    for (int i = 0; i < pendingSaves.size(); i++) {
+        if (pendingSaves[i].watcher == watcher) {
+            save = pendingSaves.takeAt(i);
+            break;
         }
-        if (paramCount > 4) {
-            *fail = QString("Command %1 has too many parameters (%2 > 4)").arg(newCmd->code).arg(paramCount);
-            src->close();
-            return false;
+    }
+    if (!save.watcher)
+        return;
+    SaveResult result = watcher->result();
+    watcher->deleteLater();
+    updateWidgetStates();
+    if (result.ok) {
+        if (save.doc) {
+            if (save.doc->fileName() != save.fileName)
+                save.doc->setFileName(save.fileName);
+            save.doc->setDiskHash(result.contentHash);
+            // unless it was edited again after being closed
+            if (save.closeAfter && !save.doc->hasUnsavedMods() && documents.contains(save.doc))
+                discardDocument(save.doc, nullptr);
         }
-        QByteArray paramTypes = parts[2].toLatin1();
-        for (uint j = 0; j < paramCount; j++) {
-            char type = paramTypes[j];
-            if (!paramTypeMeta.valueToKey(type)) {
-                *fail = QString("Command %1 has unknown parameter type '%2' for parameter #%3").arg(newCmd->code).arg(type).arg(j + 1);
-                src->close();
-                return false;
+        updateWatchedFiles();
+        statusBar()->showMessage(result.message, 5000);
+        return;
+    }
+    // a later save of the same document has everything this one had
+    if (save.doc && !isSaving(save.doc))
+        save.doc->setUnsavedMods(true);
+    statusBar()->clearMessage();
+    QMessageBox::critical(this, "Error while saving file", QString("Could not save TSC file:\n%1").arg(result.message));
+}
+
+bool MainWindow::isSaving(TSCDocument *target) const
+{
+    for (const PendingSave &save : pendingSaves) {
+        if (save.doc == target)
+            return true;
+    }
+    return false;
+}
+
+bool MainWindow::waitForSaves(TSCDocument *target)
+{
+    // for when the result is needed right away; reports every save of target, returns false if any of them failed
+    bool ok = true;
+    for (;;) {
+        QFutureWatcher<SaveResult> *watcher = nullptr;
+        for (const PendingSave &save : qAsConst(pendingSaves)) {
+            if (save.doc == target) {
+                watcher = save.watcher;
+                break;
             }
-            newCmd->params[j].first = static_cast<TSCCommand::ParameterType>(type);
-        }
-        newCmd->name = parts[3];
-        newCmd->description = parts[4];
-        if (!extendedFormat) {
-            commands += newCmd;
-            continue;
         }
-        newCmd->endsEvent = parts[5].toUInt(&ok) > 0;
-        if (!ok) {
-            *fail = QString("Command %1 has unparsable number %2 in part %3").arg(newCmd->code).arg(parts[5]).arg(partNames[5]);
-            src->close();
-            return false;
-        }
-        newCmd->clearsTextbox = parts[6].toUInt(&ok) > 0;
-        if (!ok) {
-            *fail = QString("Command %1 has unparsable number %2 in part %3").arg(newCmd->code).arg(parts[6]).arg(partNames[6]);
-            src->close();
-            return false;
-        }
-        newCmd->paramsAreSeparated = parts[7].toUInt(&ok) > 0;
-        if (!ok) {
-            *fail = QString("Command %1 has unparsable number %2 in part %3").arg(newCmd->code).arg(parts[7]).arg(partNames[7]);
-            src->close();
-            return false;
-        }
-        for (uint j = 0; j < paramCount; j++) {
-            newCmd->params[j].second = parts[8 + j].toUInt(&ok);
-            if (!ok) {
-                *fail = QString("Command %1 has unparsable number %2 in part %3").arg(newCmd->code).arg(parts[8 + j]).arg(partNames[8 + j]);
-                src->close();
-                return false;
-            }
-            if (newCmd->params[j].second == 0 || newCmd->params[j].second > 4) {
-                *fail = QString("Command %1 has bad parameter length for parameter #%2 (%3 == 0 or %3 > 4)").arg(newCmd->code).arg(j + 1).arg(newCmd->params[j].second);
-                src->close();
-                return false;
+        if (!watcher)
+            return ok;
+        watcher->waitForFinished();
+        ok = watcher->result().ok && ok;
+        saveFinished(watcher);
+    }
+}
+
+bool MainWindow::closeFile(int index)
+{
+    TSCDocument *target = documents[index];
+    if (target->isLoading()) {
+        cancelLoad(target);
+        return true;
+    }
+    if (!promptUnsavedMods(target))
+        return false;
+    // if the save fails, the edits would go along with the document, so it stays open until saveFinished() knows
+    if (isSaving(target)) {
+        for (int i = pendingSaves.size() - 1; i >= 0; i--) {
+            if (pendingSaves[i].doc == target) {
+                pendingSaves[i].closeAfter = true;
+                break;
             }
         }
-        commands += newCmd;
+        statusBar()->showMessage(QString("\"%1\" will be closed once it's saved").arg(target->displayName()));
+        return true;
     }
-    // done!
-    src->close();
-    lastSaveLocation = src;
-    fileLoaded = true;
-    unsavedMods = false;
-    updateWidgetStates();
-    *fail = QString("Successfully loaded %1 commands from \"%2\"").arg(commands.size()).arg(src->fileName());
+    discardDocument(target, nullptr);
+    updateWatchedFiles();
     return true;
 }
 
-bool MainWindow::saveFile(QFile *dst, QString *fail)
+void MainWindow::updateWatchedFiles()
 {
-    if (!dst->open(QFile::WriteOnly)) {
-        *fail = "Could not open file for writing";
-        return false;
+    QStringList wanted;
+    for (TSCDocument *d : qAsConst(documents)) {
+        if (!d->isLoading() && !d->fileName().isEmpty() && QFileInfo::exists(d->fileName()))
+            wanted += d->fileName();
     }
-    QTextStream ts(dst);
-    // write header
-    ts << "[BL_TSC]\t" << commands.size() << endl;
-    // write commands
-    TSCCommandPtr cmd;
-    foreach (cmd, commands) {
-        ts << cmd->code << '\t';
-        uint paramCount = 0;
-        QByteArray paramTypes(4, '-');
-        for (uint i = 0; i < 4; i++) {
-            if (cmd->params[i].first == TSCCommand::None)
-                break;
-            paramCount++;
-            paramTypes[i] = cmd->params[i].first;
+    const QStringList watched = fileWatcher->files();
+    for (const QString &path : watched) {
+        if (!wanted.contains(path))
+            fileWatcher->removePath(path);
+    }
+    for (const QString &path : qAsConst(wanted)) {
+        if (!watched.contains(path))
+            fileWatcher->addPath(path);
+    }
+}
+
+void MainWindow::fileChanged(const QString &path)
+{
+    changedFiles += path;
+    reloadTimer->start();
+}
+
+void MainWindow::reloadChangedFiles()
+{
+    // files that get replaced rather than written to drop out of the watcher
+    updateWatchedFiles();
+    bool useCache = ui->actionUseCache->isChecked();
+    const QSet<QString> paths = changedFiles;
+    changedFiles.clear();
+    for (const QString &path : paths) {
+        TSCDocument *target = nullptr;
+        for (TSCDocument *d : qAsConst(documents)) {
+            if (d->fileName() == path && !d->isLoading())
+                target = d;
         }
-        ts << paramCount << '\t' << paramTypes << '\t';
-        ts << cmd->name << '\t' << cmd->description;
-        ts << '\t';
-        if (cmd->endsEvent)
-            ts << 1;
-        else
-            ts << 0;
-        ts << '\t';
-        if (cmd->clearsTextbox)
-            ts << 1;
-        else
-            ts << 0;
-        ts << '\t';
-        if (cmd->paramsAreSeparated)
-            ts << 1;
-        else
-            ts << 0;
-        for (uint i = 0; i < 4; i++) {
-            ts << '\t' << cmd->params[i].second;
+        if (!target)
+            continue;
+        // don't pull rows out from under an open dialog, or compare against a save that hasn't finished
+        if (QApplication::activeModalWidget() || isSaving(target)) {
+            changedFiles += path;
+            reloadTimer->start();
+            continue;
         }
-        ts << endl;
+        if (!QFileInfo::exists(path)) {
+            target->setUnsavedMods(true);
+            statusBar()->showMessage(QString("\"%1\" was deleted or moved by another program").arg(path), 5000);
+            continue;
+        }
+        QPointer<TSCDocument> guard = target;
+        QFutureWatcher<TSCDocument::LoadResult> *watcher = new QFutureWatcher<TSCDocument::LoadResult>(this);
+        connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, guard]() {
+            if (guard)
+                reloadFinished(guard, watcher->result());
+            watcher->deleteLater();
+        });
+        watcher->setFuture(QtConcurrent::run([path, useCache]() {
+            return TSCDocument::readFile(path, useCache);
+        }));
     }
-    *fail = QString("Successfully saved %1 commands to \"%2\"").arg(commands.size()).arg(dst->fileName());
-    dst->close();
-    unsavedMods = false;
-    return true;
 }
 
-void MainWindow::unloadFile()
+void MainWindow::reloadFinished(TSCDocument *target, const TSCDocument::LoadResult &result)
 {
-    fileLoaded = false;
-    commands.clear();
-    lastSaveLocation = nullptr;
+    // a dialog may have opened (or a save started) while the file was being read; dialogs hold on to
+    // rows that applying this would shift or remove, so read it again once they're done
+    if (QApplication::activeModalWidget() || isSaving(target)) {
+        changedFiles += target->fileName();
+        reloadTimer->start();
+        return;
+    }
+    QString name = target->displayName();
+    if (!result.ok) {
+        statusBar()->showMessage(QString("Could not reload \"%1\": %2").arg(name).arg(result.message), 5000);
+        return;
+    }
+    // our own save, or the file was only touched
+    if (result.contentHash == target->diskHash())
+        return;
+    if (target->hasUnsavedMods()) {
+        tabDocs->setCurrentIndex(documents.indexOf(target));
+        if (QMessageBox::question(this, "File changed", QString("\"%1\" was changed by another program, but also has unsaved changes here.\nReload it anyway? (This can be undone.)").arg(name)) != QMessageBox::Yes) {
+            // what's here still isn't what's on disk
+            target->setDiskHash(result.contentHash);
+            target->setUnsavedMods(true);
+            return;
+        }
+    }
+    int changed = target->applyExternalChange(result.commands);
+    target->setDiskHash(result.contentHash);
+    target->setUnsavedMods(false);
+    statusBar()->showMessage(QString("Reloaded \"%1\" (%2 command(s) changed)").arg(name).arg(changed), 5000);
+}
+
+void MainWindow::addDocument(TSCDocument *newDoc)
+{
+    newDoc->history()->setByteBudget(QSettings().value("undoByteBudget", TSCUndoHistory::DefaultByteBudget).toLongLong());
+    documents += newDoc;
+    connect(newDoc, &TSCDocument::stateChanged, this, &MainWindow::documentStateChanged);
+    tabDocs->addTab(newDoc->displayName());
+    tabDocs->setCurrentIndex(documents.size() - 1);
+}
+
+void MainWindow::currentDocumentChanged(int index)
+{
+    doc = index >= 0 ? documents[index] : nullptr;
+    QAbstractItemModel *newModel = doc ? doc->filter() : nullptr;
+    if (ui->lvCmds->model() != newModel) {
+        // views don't clean up the selection models they make
+        QItemSelectionModel *oldSelection = ui->lvCmds->selectionModel();
+        ui->lvCmds->setModel(newModel);
+        delete oldSelection;
+    }
+    ui->leFilter->setText(doc ? doc->filter()->query() : QString());
+    // every document has its own view order
+    QVector<TSCCommandSorter::SortKey> keys = doc ? doc->filter()->sortKeys() : QVector<TSCCommandSorter::SortKey>();
+    ui->actionSortFileOrder->setChecked(true);
+    for (QAction *action : sortActions->actions()) {
+        if (!keys.isEmpty() && action->data().isValid() && action->data().toInt() == keys[0].key)
+            action->setChecked(true);
+    }
+    ui->actionSortDescending->setChecked(!keys.isEmpty() && keys[0].order == Qt::DescendingOrder);
     updateWidgetStates();
 }
 
+void MainWindow::documentStateChanged()
+{
+    TSCDocument *changed = qobject_cast<TSCDocument *>(sender());
+    int index = documents.indexOf(changed);
+    if (index < 0)
+        return;
+    tabDocs->setTabText(index, changed->displayName() + (changed->hasUnsavedMods() ? "*" : "") + (changed->isLoading() ? " (loading)" : ""));
+    tabDocs->setTabToolTip(index, changed->fileName());
+    if (changed == doc)
+        updateWidgetStates();
+}
+
 void MainWindow::updateWidgetStates()
 {
-    syncCommandsModel();
-    ui->actionSave->setEnabled(fileLoaded);
-    ui->actionSaveAs->setEnabled(fileLoaded);
-    ui->actionUnload->setEnabled(fileLoaded);
-    ui->lvCmds->setEnabled(fileLoaded);
+    // lists that are still loading can be looked at, but not touched
+    bool fileLoaded = doc != nullptr && !doc->isLoading();
+    if (doc)
+        setWindowTitle(QString("%1%2 - TSCListEdit").arg(doc->displayName()).arg(doc->hasUnsavedMods() ? "*" : ""));
+    else
+        setWindowTitle("TSCListEdit");
+    ui->actionSave->setEnabled(fileLoaded && !isSaving(doc));
+    ui->actionSaveAs->setEnabled(fileLoaded && !isSaving(doc));
+    ui->actionUnload->setEnabled(doc != nullptr);
+    ui->actionCancelLoad->setEnabled(!pendingLoads.isEmpty());
+    ui->actionUndo->setEnabled(fileLoaded && doc->history()->canUndo());
+    ui->actionUndo->setText(fileLoaded && doc->history()->canUndo() ? QString("Undo %1").arg(doc->history()->undoText()) : QString("Undo"));
+    ui->actionRedo->setEnabled(fileLoaded && doc->history()->canRedo());
+    ui->actionRedo->setText(fileLoaded && doc->history()->canRedo() ? QString("Redo %1").arg(doc->history()->redoText()) : QString("Redo"));
+    ui->actionValidateScripts->setEnabled(fileLoaded);
+    ui->actionMergeLists->setEnabled(fileLoaded && !mergeRunning);
+    ui->actionExportHeader->setEnabled(fileLoaded);
+    ui->lvCmds->setEnabled(doc != nullptr);
+    ui->leFilter->setEnabled(fileLoaded);
     ui->btnAdd->setEnabled(fileLoaded);
     ui->btnRemove->setEnabled(fileLoaded);
     ui->btnEdit->setEnabled(fileLoaded);
     ui->btnSort->setEnabled(fileLoaded);
+    ui->menuSortBy->setEnabled(fileLoaded);
 }
 
-void MainWindow::syncCommandsModel()
+int MainWindow::selectedRow() const
 {
-    lvCmdsModel = new QStandardItemModel();
-    for (int i = 0; i < commands.size(); i++) {
-        TSCCommandPtr cmd = commands[i];
-        QStandardItem *item = new QStandardItem;
-        item->setText(QString("<code>%1</code> - %2").arg(cmd->code.toHtmlEscaped()).arg(cmd->name.toHtmlEscaped()));
-        item->setToolTip(cmd->description);
-        item->setData(i);
-        lvCmdsModel->appendRow(item);
-    }
-    ui->lvCmds->setModel(lvCmdsModel);
-    ui->lvCmds->setItemDelegate(new HTMLDelegate);
+    if (!doc)
+        return -1;
+    QModelIndexList selected = ui->lvCmds->selectionModel()->selectedIndexes();
+    if (selected.isEmpty())
+        return -1;
+    return doc->filter()->mapToSource(selected[0]).row();
+}
+
+QVector<int> MainWindow::selectedRows() const
+{
+    if (!doc)
+        return QVector<int>();
+    const QModelIndexList selected = ui->lvCmds->selectionModel()->selectedIndexes();
+    QVector<int> rows;
+    rows.reserve(selected.size());
+    for (const QModelIndex &index : selected)
+        rows += doc->filter()->mapToSource(index).row();
+    // in file order, which is what the batch edits of TSCCommandModel want
+    std::sort(rows.begin(), rows.end());
+    return rows;
 }
 
-bool MainWindow::promptUnsavedMods()
+void MainWindow::selectRow(int row)
 {
-    if (!fileLoaded || !unsavedMods)
+    QModelIndex ni = doc->filter()->mapFromSource(doc->model()->index(row));
+    ui->lvCmds->selectionModel()->select(ni, QItemSelectionModel::ClearAndSelect);
+    ui->lvCmds->scrollTo(ni);
+}
+
+bool MainWindow::promptUnsavedMods(TSCDocument *target)
+{
+    if (!target->hasUnsavedMods())
         return true;
-    switch (QMessageBox::question(this, "Unsaved changes", "Save changes to file?", QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel)) {
+    switch (QMessageBox::question(this, "Unsaved changes", QString("Save changes to \"%1\"?").arg(target->displayName()), QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel)) {
     case QMessageBox::Yes:
-        on_actionSave_triggered();
-        return true;
+        return saveFile(target, false);
     case QMessageBox::No:
         return true;
     default:
@@ -292,98 +523,126 @@ bool MainWindow::promptUnsavedMods()
 
 void MainWindow::closeEvent(QCloseEvent *event)
 {
-    event->setAccepted(promptUnsavedMods());
+    const QList<TSCDocument *> open = documents;
+    for (TSCDocument *d : open) {
+        // a save that's still running decides whether there's anything left to ask about
+        waitForSaves(d);
+        if (!documents.contains(d))
+            continue;
+        // don't quit after a save that failed; saveFinished() has said why
+        if (!promptUnsavedMods(d) || !waitForSaves(d)) {
+            event->ignore();
+            return;
+        }
+    }
+    // workers post their rows to this window, so they have to stop first
+    cancelLoad(nullptr);
+    for (const PendingLoad &load : qAsConst(pendingLoads))
+        load.watcher->waitForFinished();
+    event->accept();
 }
 
-
 void MainWindow::on_actionNew_triggered()
 {
-    if (!promptUnsavedMods())
-        return;
     newFile();
 }
 
 void MainWindow::on_actionOpen_triggered()
 {
-    if (!promptUnsavedMods())
-        return;
-    QString filename = QFileDialog::getOpenFileName(this, "Open TSC list", "", "TSC list files (*.txt)");
-    if (filename.isNull())
-        return;
-    QFile *file = new QFile(filename, this);
-    QString fail;
-    if (!loadFile(file, &fail))
-        QMessageBox::critical(this, "Error while loading file", QString("Could not load TSC file:\n%1").arg(fail));
+    QStringList filenames = QFileDialog::getOpenFileNames(this, "Open TSC lists", "", "TSC list files (*.txt)");
+    for (const QString &filename : filenames)
+        loadFile(filename);
 }
 
 void MainWindow::on_actionSave_triggered()
 {
-    on_btnSort_clicked();
-    if (!lastSaveLocation) {
-        on_actionSaveAs_triggered();
-        return;
-    }
-    QString fail;
-    if (!saveFile(lastSaveLocation, &fail))
-        QMessageBox::critical(this, "Error while saving file", QString("Could not save TSC file:\n%1").arg(fail));
+    if (doc)
+        saveFile(doc, false);
 }
 
 void MainWindow::on_actionSaveAs_triggered()
 {
-    on_btnSort_clicked();
-    QString filename = QFileDialog::getSaveFileName(this, "Save TSC list", "", "TSC list files (*.txt)");
-    if (filename.isNull())
-        return;
-    lastSaveLocation = new QFile(filename, this);
-    QString fail;
-    if (!saveFile(lastSaveLocation, &fail))
-        QMessageBox::critical(this, "Error while saving file", QString("Could not save TSC file:\n%1").arg(fail));
+    if (doc)
+        saveFile(doc, true);
 }
 
 #include <QDebug>
 
 void MainWindow::on_btnAdd_clicked()
 {
-    int i = commands.size();
-    TSCCommandPtr newCmd = TSCCommandPtr(new TSCCommand);
-    newCmd->code = "<NEW";
-    newCmd->name = "NEW command";
-    commands += newCmd;
-    QStandardItem *item = new QStandardItem;
-    item->setText(QString("<code>%1</code> - %2").arg(newCmd->code.toHtmlEscaped()).arg(newCmd->name.toHtmlEscaped()));
-    item->setToolTip(newCmd->description);
-    item->setData(i);
-    lvCmdsModel->appendRow(item);
-    QModelIndex ni = lvCmdsModel->indexFromItem(item);
-    ui->lvCmds->selectionModel()->select(ni, QItemSelectionModel::ClearAndSelect);
+    TSCCommand newCmd;
+    newCmd.setCode("<NEW");
+    newCmd.name = "NEW command";
+    // make sure the new command isn't filtered out
+    ui->leFilter->clear();
+    // adding and filling in the new command is undone in one go
+    doc->history()->beginGroup("Add command");
+    selectRow(doc->model()->appendCommand(newCmd));
     on_btnEdit_clicked();
+    doc->history()->endGroup();
 }
 
 void MainWindow::on_btnRemove_clicked()
 {
-    QModelIndex di = ui->lvCmds->selectionModel()->selectedIndexes()[0];
-    int i = di.data(Qt::UserRole + 1).toInt();
-    TSCCommandPtr cmd = commands[i];
-    if (QMessageBox::question(this, "Delete command?", QString("Are you sure you want to delete command %1?").arg(cmd->code)) != QMessageBox::Yes)
+    QVector<int> rows = selectedRows();
+    if (rows.isEmpty())
         return;
-    commands.removeAt(i);
-    syncCommandsModel();
-    ui->lvCmds->selectionModel()->select(di, QItemSelectionModel::ClearAndSelect);
+    if (rows.size() == 1) {
+        const TSCCommand &cmd = doc->commands().at(rows[0]);
+        if (QMessageBox::question(this, "Delete command?", QString("Are you sure you want to delete command %1?").arg(cmd.code())) != QMessageBox::Yes)
+            return;
+        doc->model()->removeCommand(rows[0]);
+    } else {
+        if (QMessageBox::question(this, "Delete commands?", QString("Are you sure you want to delete %1 commands?").arg(rows.size())) != QMessageBox::Yes)
+            return;
+        doc->model()->removeCommands(rows);
+    }
+    if (!doc->commands().isEmpty())
+        selectRow(qMin(rows[0], doc->commands().size() - 1));
 }
 
 void MainWindow::on_btnEdit_clicked()
 {
-    int i = ui->lvCmds->selectionModel()->selectedIndexes()[0].data(Qt::UserRole + 1).toInt();
-    CommandEditDialog *ced = new CommandEditDialog(commands[i], this);
-    connect(ced, &CommandEditDialog::commandReady, this, &MainWindow::commandReady);
-    ced->exec();
+    // finishLoading() would take the edit as part of the loaded list
+    if (!doc || doc->isLoading())
+        return;
+    QVector<int> rows = selectedRows();
+    if (rows.size() > 1) {
+        editCommands(rows);
+        return;
+    }
+    int i = selectedRow();
+    if (i < 0)
+        return;
+    if (!commandEditor) {
+        commandEditor = new CommandEditDialog(this);
+        connect(commandEditor, &CommandEditDialog::commandReady, this, &MainWindow::commandReady);
+    }
+    commandEditor->setCommand(doc->commands().at(i));
+    commandEditor->exec();
+}
+
+void MainWindow::on_actionUndo_triggered()
+{
+    if (doc)
+        doc->history()->undo();
+}
+
+void MainWindow::on_actionRedo_triggered()
+{
+    if (doc)
+        doc->history()->redo();
 }
 
 void MainWindow::on_actionUnload_triggered()
 {
-    if (!promptUnsavedMods())
-        return;
-    unloadFile();
+    if (doc)
+        closeFile(tabDocs->currentIndex());
+}
+
+void MainWindow::on_actionCancelLoad_triggered()
+{
+    cancelLoad(nullptr);
 }
 
 void MainWindow::on_actionExit_triggered()
@@ -393,37 +652,197 @@ void MainWindow::on_actionExit_triggered()
 
 void MainWindow::on_lvCmds_doubleClicked(const QModelIndex &index)
 {
+    if (!doc || doc->isLoading())
+        return;
     ui->lvCmds->selectionModel()->select(index, QItemSelectionModel::ClearAndSelect);
     on_btnEdit_clicked();
 }
 
-void MainWindow::commandReady(CommandEditDialog *ced, TSCCommandPtr newCmd)
+void MainWindow::editCommands(const QVector<int> &rows)
 {
-    int si = ui->lvCmds->selectionModel()->selectedIndexes()[0].data(Qt::UserRole + 1).toInt();
-    for (int i = 0; i < commands.size(); i++) {
-        if (i == si)
-            continue;
-        TSCCommandPtr cmd = commands[i];
-        if (cmd->code.compare(newCmd->code) == 0) {
-            QMessageBox::critical(this, "Conflicting code", QString("Code %1 is already in use.").arg(cmd->code));
-            return;
+    QVector<TSCCommand> cmds;
+    cmds.reserve(rows.size());
+    for (int row : rows)
+        cmds += doc->commands().at(row);
+    BatchEditDialog bed(cmds, this);
+    if (bed.exec() != QDialog::Accepted)
+        return;
+    // only rows that actually change are replaced (and kept for undo)
+    QVector<int> changedRows;
+    QVector<TSCCommand> changedCmds;
+    for (int i = 0; i < rows.size(); i++) {
+        if (bed.apply(&cmds[i])) {
+            changedRows += rows[i];
+            changedCmds += cmds[i];
         }
     }
+    doc->model()->replaceCommands(changedRows, changedCmds);
+}
+
+void MainWindow::commandReady(CommandEditDialog *ced, const TSCCommand &newCmd)
+{
+    int si = selectedRow();
+    if (doc->commands().conflictingRow(newCmd.codeKey(), si) >= 0) {
+        QMessageBox::critical(this, "Conflicting code", QString("Code %1 is already in use.").arg(newCmd.code()));
+        return;
+    }
     ced->accept();
-    commands[si] = newCmd;
-    QStandardItem *item = lvCmdsModel->item(si);
-    item->setText(QString("<code>%1</code> - %2").arg(newCmd->code.toHtmlEscaped()).arg(newCmd->name.toHtmlEscaped()));
-    item->setToolTip(newCmd->description);
-    unsavedMods = true;
+    doc->model()->replaceCommand(si, newCmd);
+}
+
+void MainWindow::on_actionValidateScripts_triggered()
+{
+    QString directory = QFileDialog::getExistingDirectory(this, "Validate TSC scripts");
+    if (directory.isNull())
+        return;
+    QStringList scripts = TSCScriptValidator::findScripts(directory);
+    if (scripts.isEmpty()) {
+        QMessageBox::information(this, "Validate scripts", QString("No .tsc files found in \"%1\".").arg(directory));
+        return;
+    }
+    TSCScriptValidator::FileValidator validator { TSCScriptValidator(doc->commands().commands()) };
+    QElapsedTimer timer;
+    timer.start();
+    QFutureWatcher<QVector<TSCScriptIssue>> *watcher = new QFutureWatcher<QVector<TSCScriptIssue>>(this);
+    connect(watcher, &QFutureWatcherBase::progressValueChanged, this, [this, watcher](int progress) {
+        statusBar()->showMessage(QString("Validating scripts... %1/%2").arg(progress).arg(watcher->progressMaximum()));
+    });
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, directory, timer]() {
+        qint64 msecs = timer.elapsed();
+        QVector<TSCScriptIssue> issues;
+        const QList<QVector<TSCScriptIssue>> results = watcher->future().results();
+        for (const QVector<TSCScriptIssue> &result : results)
+            issues += result;
+        statusBar()->clearMessage();
+        ScriptValidationDialog *svd = new ScriptValidationDialog(directory, issues, results.size(), msecs, this);
+        svd->setAttribute(Qt::WA_DeleteOnClose);
+        svd->show();
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::mapped(scripts, validator));
 }
 
-bool cmpTSCCmdPtrs(const TSCCommandPtr& a, const TSCCommandPtr& b) {
-    return a->code < b->code;
+void MainWindow::on_actionMergeLists_triggered()
+{
+    QString theirFile = QFileDialog::getOpenFileName(this, "Merge with list", "", "TSC list files (*.txt)");
+    if (theirFile.isNull())
+        return;
+    // without a common ancestor, everything both lists have but disagree on is a conflict
+    QString baseFile = QFileDialog::getOpenFileName(this, "Common ancestor of both lists (cancel to merge without one)", "", "TSC list files (*.txt)");
+    // read in the background, like any other list
+    QPointer<TSCDocument> guard = doc;
+    QFutureWatcher<MergeInputs> *watcher = new QFutureWatcher<MergeInputs>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, guard, theirFile, baseFile]() {
+        mergeRunning = false;
+        if (guard)
+            mergeFilesRead(guard, theirFile, baseFile, watcher->result());
+        updateWidgetStates();
+        watcher->deleteLater();
+    });
+    mergeRunning = true;
+    updateWidgetStates();
+    watcher->setFuture(QtConcurrent::run([theirFile, baseFile]() {
+        MergeInputs inputs;
+        inputs.theirs = TSCDocument::readFile(theirFile, false);
+        if (inputs.theirs.ok && !baseFile.isNull())
+            inputs.base = TSCDocument::readFile(baseFile, false);
+        return inputs;
+    }));
+    statusBar()->showMessage(QString("Reading \"%1\"...").arg(theirFile));
+}
+
+void MainWindow::mergeFilesRead(TSCDocument *target, const QString &theirFile, const QString &baseFile, const MergeInputs &inputs)
+{
+    statusBar()->clearMessage();
+    if (!inputs.theirs.ok) {
+        QMessageBox::critical(this, "Error while loading list", QString("Could not load \"%1\":\n%2").arg(theirFile).arg(inputs.theirs.message));
+        return;
+    }
+    if (!baseFile.isNull() && !inputs.base.ok) {
+        QMessageBox::critical(this, "Error while loading list", QString("Could not load \"%1\":\n%2").arg(baseFile).arg(inputs.base.message));
+        return;
+    }
+    tabDocs->setCurrentIndex(documents.indexOf(target));
+    TSCListMerge::Result result;
+    QString fail;
+    if (!TSCListMerge::merge(inputs.base.commands.commands(), target->commands().commands(), inputs.theirs.commands.commands(), &result, &fail)) {
+        QMessageBox::critical(this, "Could not merge lists", fail);
+        return;
+    }
+    MergeDialog md(result, QFileInfo(theirFile).fileName(), this);
+    if (md.exec() != QDialog::Accepted)
+        return;
+    TSCCommandTable merged;
+    const QVector<TSCCommand> mergedCommands = md.mergedCommands();
+    merged.reserve(mergedCommands.size());
+    for (const TSCCommand &cmd : mergedCommands)
+        merged.append(cmd);
+    int changed = target->applyExternalChange(merged, "Merge");
+    statusBar()->showMessage(QString("Merged \"%1\", %2 row(s) changed").arg(QFileInfo(theirFile).fileName()).arg(changed), 5000);
+}
+
+void MainWindow::on_actionExportHeader_triggered()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Export C++ header", "tsc_commands.h", "C++ headers (*.h *.hpp)");
+    if (fileName.isNull())
+        return;
+    QString fail;
+    if (!TSCHeaderExporter::exportFile(fileName, doc->commands().commands(), doc->displayName(), &fail)) {
+        QMessageBox::critical(this, "Error while exporting header", QString("Could not export header:\n%1").arg(fail));
+        return;
+    }
+    statusBar()->showMessage(QString("Exported %1 commands to \"%2\"").arg(doc->commands().size()).arg(fileName), 5000);
+}
+
+void MainWindow::on_leFilter_textChanged(const QString &text)
+{
+    if (doc)
+        doc->filter()->setQuery(text);
+}
+
+void MainWindow::on_actionUseCache_toggled(bool checked)
+{
+    QSettings().setValue("useCache", checked);
+}
+
+void MainWindow::on_actionRecordTrace_toggled(bool checked)
+{
+    // start every recording from scratch
+    if (checked && !TSCTrace::isEnabled())
+        TSCTrace::clear();
+    TSCTrace::setEnabled(checked);
+}
+
+void MainWindow::on_actionExportTrace_triggered()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Export trace", "trace.json", "Trace files (*.json)");
+    if (fileName.isNull())
+        return;
+    QString fail;
+    if (!TSCTrace::exportChromeTrace(fileName, &fail)) {
+        QMessageBox::critical(this, "Error while exporting trace", QString("Could not export trace:\n%1").arg(fail));
+        return;
+    }
+    statusBar()->showMessage(QString("Exported trace to \"%1\"").arg(fileName), 5000);
 }
 
 void MainWindow::on_btnSort_clicked()
 {
-    commands.removeAll(nullptr);
-    std::sort(commands.begin(), commands.end(), cmpTSCCmdPtrs);
-    syncCommandsModel();
+    doc->model()->sortByCode();
+}
+
+void MainWindow::viewSortChanged()
+{
+    if (!doc)
+        return;
+    QVector<TSCCommandSorter::SortKey> keys;
+    QAction *checked = sortActions->checkedAction();
+    if (checked && checked->data().isValid()) {
+        TSCCommandSorter::Key key = static_cast<TSCCommandSorter::Key>(checked->data().toInt());
+        keys += { key, ui->actionSortDescending->isChecked() ? Qt::DescendingOrder : Qt::AscendingOrder };
+        // ties are broken by code (codes are unique, so that settles it)
+        if (key != TSCCommandSorter::Code)
+            keys += { TSCCommandSorter::Code, Qt::AscendingOrder };
+    }
+    doc->filter()->setSortKeys(keys);
 }
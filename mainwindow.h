@@ -2,13 +2,20 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
-#include <QStandardItemModel>
-#include <QFile>
-#include "tsccommand.h"
+#include <QPointer>
+#include <QSet>
+#include <QFutureWatcher>
+#include <atomic>
+#include <memory>
+#include "tscdocument.h"
 #include "commandeditdialog.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
+class QTabBar;
+class QFileSystemWatcher;
+class QTimer;
+class QActionGroup;
 QT_END_NAMESPACE
 
 class MainWindow : public QMainWindow
@@ -20,21 +27,70 @@ public:
     ~MainWindow();
 
 private:
-    bool fileLoaded;
-    QList<TSCCommandPtr> commands;
-    QStandardItemModel *lvCmdsModel;
-    bool unsavedMods;
-    QFile *lastSaveLocation;
+    QList<TSCDocument *> documents;
+    TSCDocument *doc;
+    QTabBar *tabDocs;
+    // a list being read (and shown) in the background, see loadFile()
+    struct PendingLoad {
+        TSCDocument *doc = nullptr;
+        QPointer<TSCDocument> previous;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+        QFutureWatcher<TSCDocument::LoadResult> *watcher = nullptr;
+    };
+    QList<PendingLoad> pendingLoads;
+    QStringList loadErrors;
+    struct SaveResult {
+        bool ok;
+        QString message;
+        quint64 contentHash;
+    };
+    // a save running in the background, see saveFile(); reported (and dropped) by saveFinished()
+    struct PendingSave {
+        QPointer<TSCDocument> doc;
+        QString fileName;
+        QFutureWatcher<SaveResult> *watcher = nullptr;
+        // the document was closed while saving, see closeFile()
+        bool closeAfter = false;
+    };
+    QList<PendingSave> pendingSaves;
+    QFileSystemWatcher *fileWatcher;
+    // outside changes often come as a burst of writes, so wait for them to settle
+    QTimer *reloadTimer;
+    QSet<QString> changedFiles;
+    QActionGroup *sortActions;
+    // the other lists of a merge, read in the background
+    struct MergeInputs {
+        TSCDocument::LoadResult theirs;
+        TSCDocument::LoadResult base;
+    };
+    bool mergeRunning;
+    // created on first use and reused after that
+    CommandEditDialog *commandEditor;
 
     void newFile();
-    bool loadFile(QFile *src, QString *error);
-    bool saveFile(QFile *dst, QString *error);
-    void unloadFile();
+    void loadFile(const QString &fileName);
+    bool saveFile(TSCDocument *target, bool saveAs);
+    void saveFinished(QFutureWatcher<SaveResult> *watcher);
+    bool isSaving(TSCDocument *target) const;
+    bool waitForSaves(TSCDocument *target);
+    bool closeFile(int index);
+    void cancelLoad(TSCDocument *target);
+    void discardDocument(TSCDocument *target, TSCDocument *switchTo);
 
+    void updateWatchedFiles();
+    void fileChanged(const QString &path);
+    void reloadChangedFiles();
+    void reloadFinished(TSCDocument *target, const TSCDocument::LoadResult &result);
+    void mergeFilesRead(TSCDocument *target, const QString &theirFile, const QString &baseFile, const MergeInputs &inputs);
+
+    void addDocument(TSCDocument *newDoc);
     void updateWidgetStates();
-    void syncCommandsModel();
+    int selectedRow() const;
+    QVector<int> selectedRows() const;
+    void selectRow(int row);
+    void editCommands(const QVector<int> &rows);
 
-    bool promptUnsavedMods();
+    bool promptUnsavedMods(TSCDocument *target);
 
     void closeEvent(QCloseEvent *event);
 
@@ -46,13 +102,30 @@ private slots:
     void on_btnAdd_clicked();
     void on_btnRemove_clicked();
     void on_btnEdit_clicked();
+    void on_actionUndo_triggered();
+    void on_actionRedo_triggered();
     void on_actionUnload_triggered();
+    void on_actionCancelLoad_triggered();
     void on_actionExit_triggered();
     void on_lvCmds_doubleClicked(const QModelIndex &index);
 
-    void commandReady(CommandEditDialog *ced, TSCCommandPtr newCmd);
+    void commandReady(CommandEditDialog *ced, const TSCCommand &newCmd);
 
     void on_btnSort_clicked();
+    void viewSortChanged();
+
+    void loadProgress(TSCDocument *target, const QVector<TSCCommand> &batch, qint64 bytesDone, qint64 bytesTotal);
+    void loadFinished(TSCDocument *target);
+    void currentDocumentChanged(int index);
+    void documentStateChanged();
+
+    void on_actionValidateScripts_triggered();
+    void on_actionMergeLists_triggered();
+    void on_actionExportHeader_triggered();
+    void on_leFilter_textChanged(const QString &text);
+    void on_actionUseCache_toggled(bool checked);
+    void on_actionRecordTrace_toggled(bool checked);
+    void on_actionExportTrace_triggered();
 
 private:
     Ui::MainWindow *ui;
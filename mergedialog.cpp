@@ -0,0 +1,120 @@
+#include "mergedialog.h"
+#include "ui_mergedialog.h"
+
+#include "tsctrace.h"
+
+namespace {
+
+// items for conflicts keep the conflict's index here
+const int ConflictRole = Qt::UserRole + 1;
+const int UseColumn = 4;
+
+QString sideText(TSCListMerge::Side side)
+{
+    return side == TSCListMerge::Ours ? "ours" : "theirs";
+}
+
+}
+
+MergeDialog::MergeDialog(const TSCListMerge::Result &result, const QString &theirName, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::MergeDialog),
+    result(result),
+    choices(result.conflicts.size(), TSCListMerge::Ours)
+{
+    TSC_TRACE("MergeDialog::MergeDialog");
+    ui->setupUi(this);
+
+    int added = 0, removed = 0, changed = 0;
+    for (const TSCListMerge::Change &change : result.changes) {
+        switch (change.kind) {
+        case TSCListMerge::Change::Added:
+            added++;
+            break;
+        case TSCListMerge::Change::Removed:
+            removed++;
+            break;
+        case TSCListMerge::Change::Changed:
+            changed++;
+            break;
+        }
+    }
+    ui->lblSummary->setText(QString("Merging \"%1\": %2 added, %3 removed and %4 changed commands are taken from it, %5 conflict(s).")
+                            .arg(theirName).arg(added).arg(removed).arg(changed).arg(result.conflicts.size()));
+
+    QList<QTreeWidgetItem *> items;
+    items.reserve(result.conflicts.size() + result.changes.size());
+    for (int i = 0; i < result.conflicts.size(); i++) {
+        const TSCListMerge::Conflict &conflict = result.conflicts[i];
+        QTreeWidgetItem *item = new QTreeWidgetItem;
+        item->setText(0, TSCCommand::codeFromKey(conflict.codeKey));
+        if (conflict.fields != 0) {
+            item->setText(1, QString("Conflict: %1").arg(TSCListMerge::fieldNames(conflict.fields).join(", ")));
+            item->setText(2, TSCListMerge::describe(conflict.ours, conflict.fields));
+            item->setText(3, TSCListMerge::describe(conflict.theirs, conflict.fields));
+        } else {
+            item->setText(1, conflict.inOurs ? "Conflict: changed here, removed there" : "Conflict: removed here, changed there");
+            item->setText(2, conflict.inOurs ? "(changed)" : "(removed)");
+            item->setText(3, conflict.inTheirs ? "(changed)" : "(removed)");
+        }
+        item->setText(UseColumn, sideText(choices[i]));
+        item->setData(0, ConflictRole, i);
+        items += item;
+    }
+    for (const TSCListMerge::Change &change : result.changes) {
+        QTreeWidgetItem *item = new QTreeWidgetItem;
+        item->setText(0, TSCCommand::codeFromKey(change.codeKey));
+        switch (change.kind) {
+        case TSCListMerge::Change::Added:
+            item->setText(1, "Added");
+            break;
+        case TSCListMerge::Change::Removed:
+            item->setText(1, "Removed");
+            break;
+        case TSCListMerge::Change::Changed:
+            item->setText(1, QString("Changed: %1").arg(TSCListMerge::fieldNames(change.fields).join(", ")));
+            item->setText(3, TSCListMerge::describe(result.commands[change.toRow], change.fields));
+            break;
+        }
+        item->setText(UseColumn, "theirs");
+        item->setData(0, ConflictRole, -1);
+        items += item;
+    }
+    ui->twChanges->addTopLevelItems(items);
+    for (int i = 0; i < 2; i++)
+        ui->twChanges->resizeColumnToContents(i);
+    ui->btnUseOurs->setEnabled(!result.conflicts.isEmpty());
+    ui->btnUseTheirs->setEnabled(!result.conflicts.isEmpty());
+}
+
+MergeDialog::~MergeDialog()
+{
+    delete ui;
+}
+
+QVector<TSCCommand> MergeDialog::mergedCommands() const
+{
+    return TSCListMerge::resolve(result, choices);
+}
+
+void MergeDialog::on_btnUseOurs_clicked()
+{
+    choose(TSCListMerge::Ours);
+}
+
+void MergeDialog::on_btnUseTheirs_clicked()
+{
+    choose(TSCListMerge::Theirs);
+}
+
+void MergeDialog::choose(TSCListMerge::Side side)
+{
+    const QList<QTreeWidgetItem *> selected = ui->twChanges->selectedItems();
+    for (QTreeWidgetItem *item : selected) {
+        int conflict = item->data(0, ConflictRole).toInt();
+        if (conflict < 0)
+            continue;
+        choices[conflict] = side;
+        item->setText(UseColumn, sideText(side));
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef MERGEDIALOG_H
+#define MERGEDIALOG_H
+
+#include <QDialog>
+#include "tsclistmerge.h"
+
+namespace Ui {
+class MergeDialog;
+}
+
+// Shows what a three-way merge takes from the other list, and lets every
+// conflict be settled for our or their version before the merge is applied.
+
+class MergeDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit MergeDialog(const TSCListMerge::Result &result, const QString &theirName, QWidget *parent = nullptr);
+    ~MergeDialog();
+
+    QVector<TSCCommand> mergedCommands() const;
+
+private slots:
+    void on_btnUseOurs_clicked();
+    void on_btnUseTheirs_clicked();
+
+private:
+    Ui::MergeDialog *ui;
+    TSCListMerge::Result result;
+    QVector<TSCListMerge::Side> choices;
+
+    void choose(TSCListMerge::Side side);
+};
+
+#endif // MERGEDIALOG_H
@@ -0,0 +1,35 @@
+#include "scriptvalidationdialog.h"
+#include "ui_scriptvalidationdialog.h"
+
+#include <QDir>
+#include "tsctrace.h"
+
+ScriptValidationDialog::ScriptValidationDialog(const QString &directory, const QVector<TSCScriptIssue> &issues, int scriptCount, qint64 msecs, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::ScriptValidationDialog)
+{
+    TSC_TRACE("ScriptValidationDialog::ScriptValidationDialog");
+    ui->setupUi(this);
+
+    ui->lblSummary->setText(QString("Checked %1 script(s) in \"%2\" in %3 ms, found %4 issue(s).").arg(scriptCount).arg(QDir::toNativeSeparators(directory)).arg(msecs).arg(issues.size()));
+
+    QDir base(directory);
+    QList<QTreeWidgetItem *> items;
+    items.reserve(issues.size());
+    for (const TSCScriptIssue &issue : issues) {
+        QTreeWidgetItem *item = new QTreeWidgetItem;
+        item->setText(0, QDir::toNativeSeparators(base.relativeFilePath(issue.fileName)));
+        item->setData(1, Qt::DisplayRole, issue.line);
+        item->setData(2, Qt::DisplayRole, issue.column);
+        item->setText(3, issue.message);
+        items += item;
+    }
+    ui->twIssues->addTopLevelItems(items);
+    for (int i = 0; i < 3; i++)
+        ui->twIssues->resizeColumnToContents(i);
+}
+
+ScriptValidationDialog::~ScriptValidationDialog()
+{
+    delete ui;
+}
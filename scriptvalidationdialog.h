@@ -0,0 +1,23 @@
+#ifndef SCRIPTVALIDATIONDIALOG_H
+#define SCRIPTVALIDATIONDIALOG_H
+
+#include <QDialog>
+#include "tscscriptvalidator.h"
+
+namespace Ui {
+class ScriptValidationDialog;
+}
+
+class ScriptValidationDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit ScriptValidationDialog(const QString &directory, const QVector<TSCScriptIssue> &issues, int scriptCount, qint64 msecs, QWidget *parent = nullptr);
+    ~ScriptValidationDialog();
+
+private:
+    Ui::ScriptValidationDialog *ui;
+};
+
+#endif // SCRIPTVALIDATIONDIALOG_H
@@ -0,0 +1,194 @@
+#include "tsccodec.h"
+
+#include <QFile>
+#include <QSaveFile>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TSCCODEC_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define TSCCODEC_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+namespace {
+
+void addScalar(uchar *data, qint64 size, uchar delta)
+{
+    for (qint64 i = 0; i < size; i++)
+        data[i] = static_cast<uchar>(data[i] + delta);
+}
+
+#ifdef TSCCODEC_SSE2
+void addSSE2(uchar *data, qint64 size, uchar delta)
+{
+    const __m128i d = _mm_set1_epi8(static_cast<char>(delta));
+    qint64 i = 0;
+    for (; i + 64 <= size; i += 64) {
+        __m128i *p = reinterpret_cast<__m128i *>(data + i);
+        __m128i a = _mm_loadu_si128(p);
+        __m128i b = _mm_loadu_si128(p + 1);
+        __m128i c = _mm_loadu_si128(p + 2);
+        __m128i e = _mm_loadu_si128(p + 3);
+        _mm_storeu_si128(p, _mm_add_epi8(a, d));
+        _mm_storeu_si128(p + 1, _mm_add_epi8(b, d));
+        _mm_storeu_si128(p + 2, _mm_add_epi8(c, d));
+        _mm_storeu_si128(p + 3, _mm_add_epi8(e, d));
+    }
+    for (; i + 16 <= size; i += 16) {
+        __m128i *p = reinterpret_cast<__m128i *>(data + i);
+        _mm_storeu_si128(p, _mm_add_epi8(_mm_loadu_si128(p), d));
+    }
+    addScalar(data + i, size - i, delta);
+}
+#endif
+
+#ifdef TSCCODEC_AVX2
+__attribute__((target("avx2")))
+void addAVX2(uchar *data, qint64 size, uchar delta)
+{
+    const __m256i d = _mm256_set1_epi8(static_cast<char>(delta));
+    qint64 i = 0;
+    for (; i + 128 <= size; i += 128) {
+        __m256i *p = reinterpret_cast<__m256i *>(data + i);
+        __m256i a = _mm256_loadu_si256(p);
+        __m256i b = _mm256_loadu_si256(p + 1);
+        __m256i c = _mm256_loadu_si256(p + 2);
+        __m256i e = _mm256_loadu_si256(p + 3);
+        _mm256_storeu_si256(p, _mm256_add_epi8(a, d));
+        _mm256_storeu_si256(p + 1, _mm256_add_epi8(b, d));
+        _mm256_storeu_si256(p + 2, _mm256_add_epi8(c, d));
+        _mm256_storeu_si256(p + 3, _mm256_add_epi8(e, d));
+    }
+    for (; i + 32 <= size; i += 32) {
+        __m256i *p = reinterpret_cast<__m256i *>(data + i);
+        _mm256_storeu_si256(p, _mm256_add_epi8(_mm256_loadu_si256(p), d));
+    }
+    addSSE2(data + i, size - i, delta);
+}
+#endif
+
+typedef void (*AddKernel)(uchar *, qint64, uchar);
+
+struct Kernel {
+    AddKernel function;
+    const char *name;
+};
+
+Kernel pickKernel()
+{
+#ifdef TSCCODEC_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return { addAVX2, "AVX2" };
+#endif
+#ifdef TSCCODEC_SSE2
+    return { addSSE2, "SSE2" };
+#else
+    return { addScalar, "scalar" };
+#endif
+}
+
+const Kernel &kernel()
+{
+    static const Kernel picked = pickKernel();
+    return picked;
+}
+
+// shifts a chunk that starts at offset in the whole file, leaving the middle byte alone
+void transformChunk(char *chunk, qint64 chunkSize, qint64 offset, qint64 half, uchar delta)
+{
+    bool hasHalf = half >= offset && half < offset + chunkSize;
+    char middle = hasHalf ? chunk[half - offset] : 0;
+    TSCCodec::addToAll(chunk, chunkSize, delta);
+    if (hasHalf)
+        chunk[half - offset] = middle;
+}
+
+}
+
+void TSCCodec::addToAll(char *data, qint64 size, uchar delta)
+{
+    kernel().function(reinterpret_cast<uchar *>(data), size, delta);
+}
+
+const char *TSCCodec::kernelName()
+{
+    return kernel().name;
+}
+
+uchar TSCCodec::key(const char *data, qint64 size)
+{
+    if (size <= 0)
+        return 0;
+    uchar k = static_cast<uchar>(data[size / 2]);
+    return k == 0 ? 7 : k;
+}
+
+void TSCCodec::decode(char *data, qint64 size)
+{
+    transformChunk(data, size, 0, size / 2, static_cast<uchar>(-key(data, size)));
+}
+
+void TSCCodec::encode(char *data, qint64 size)
+{
+    // the middle byte is never shifted, so it carries the key over to decode()
+    transformChunk(data, size, 0, size / 2, key(data, size));
+}
+
+bool TSCCodec::decodeFile(const QString &fileName, QByteArray *out, QString *fail)
+{
+    QFile src(fileName);
+    if (!src.open(QFile::ReadOnly)) {
+        *fail = "Could not open file for reading";
+        return false;
+    }
+    *out = src.readAll();
+    decode(out->data(), out->size());
+    return true;
+}
+
+bool TSCCodec::transcodeFile(const QString &srcName, const QString &dstName, bool decode, QString *fail)
+{
+    const qint64 chunkSize = 1 << 20;
+    QFile src(srcName);
+    if (!src.open(QFile::ReadOnly)) {
+        *fail = "Could not open file for reading";
+        return false;
+    }
+    qint64 size = src.size();
+    qint64 half = size / 2;
+    char middle = 0;
+    if (size > 0 && (!src.seek(half) || !src.getChar(&middle) || !src.seek(0))) {
+        *fail = QString("Could not read file: %1").arg(src.errorString());
+        return false;
+    }
+    uchar k = middle == 0 ? 7 : static_cast<uchar>(middle);
+    uchar delta = decode ? static_cast<uchar>(-k) : k;
+    QSaveFile dst(dstName);
+    if (!dst.open(QFile::WriteOnly)) {
+        *fail = "Could not open file for writing";
+        return false;
+    }
+    QByteArray chunk(static_cast<int>(qMin(chunkSize, qMax<qint64>(size, 1))), '\0');
+    for (qint64 offset = 0; offset < size; offset += chunk.size()) {
+        qint64 want = qMin<qint64>(chunk.size(), size - offset);
+        if (src.read(chunk.data(), want) != want) {
+            *fail = QString("Could not read file: %1").arg(src.errorString());
+            dst.cancelWriting();
+            return false;
+        }
+        transformChunk(chunk.data(), want, offset, half, delta);
+        if (dst.write(chunk.constData(), want) != want) {
+            *fail = QString("Could not write file: %1").arg(dst.errorString());
+            dst.cancelWriting();
+            return false;
+        }
+    }
+    if (!dst.commit()) {
+        *fail = QString("Could not write file: %1").arg(dst.errorString());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,28 @@
+#ifndef TSCCODEC_H
+#define TSCCODEC_H
+
+#include <QString>
+
+// Cave Story .tsc obfuscation: every byte except the middle one is shifted
+// by the value of the middle one (or by 7, if that's 0).
+// The shift itself runs 16 (SSE2) or 32 (AVX2, picked at runtime) bytes at a
+// time, with a scalar fallback elsewhere.
+
+class TSCCodec
+{
+public:
+    static uchar key(const char *data, qint64 size);
+    static void decode(char *data, qint64 size);
+    static void encode(char *data, qint64 size);
+
+    static bool decodeFile(const QString &fileName, QByteArray *out, QString *fail);
+    // streams src to dst in fixed size chunks, so any size of file works
+    static bool transcodeFile(const QString &srcName, const QString &dstName, bool decode, QString *fail);
+
+    // adds delta to every byte; the building block of the above
+    static void addToAll(char *data, qint64 size, uchar delta);
+    // which addToAll() implementation this machine uses
+    static const char *kernelName();
+};
+
+#endif // TSCCODEC_H
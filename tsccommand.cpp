@@ -1,5 +1,6 @@
 #include "tsccommand.h"
-#include <QHash>
+
+#include <cstring>
 
 const QList<QPair<TSCCommand::ParameterType, QString>> TSCCommand::paramTypeNames = {
     { TSCCommand::None, "None" },
@@ -25,12 +26,133 @@ const QList<QPair<TSCCommand::ParameterType, QString>> TSCCommand::paramTypeName
     { TSCCommand::Ticks, "Ticks" },
 };
 
-TSCCommand::TSCCommand(QObject *parent) : QObject(parent)
+TSCCommand::TSCCommand() : descSpan(0)
+{
+    for (int i = 0; i < CodeLength; i++)
+        codeChars[i] = ' ';
+    flags = ParamsAreSeparatedFlag;
+    for (int i = 0; i < MaxParams; i++)
+        params[i] = { None, 4 };
+}
+
+bool TSCCommand::isValidCode(const QString &code)
+{
+    if (code.size() != CodeLength)
+        return false;
+    for (QChar c : code) {
+        if (c.unicode() > 0xFF)
+            return false;
+    }
+    return true;
+}
+
+QString TSCCommand::codeProblem(const QString &code)
+{
+    if (code.size() != CodeLength)
+        return QString("Code must be %1 characters long.").arg(CodeLength);
+    for (QChar c : code) {
+        if (c.unicode() > 0xFF)
+            return QString("Code can only use Latin-1 characters, not '%1'.").arg(c);
+    }
+    return QString();
+}
+
+quint32 TSCCommand::codeKey(const QString &code)
+{
+    quint32 key = 0;
+    for (int i = 0; i < CodeLength; i++)
+        key = (key << 8) | (i < code.size() ? static_cast<uchar>(code[i].toLatin1()) : ' ');
+    return key;
+}
+
+QString TSCCommand::codeFromKey(quint32 key)
+{
+    char chars[CodeLength];
+    for (int i = CodeLength - 1; i >= 0; i--) {
+        chars[i] = static_cast<char>(key & 0xFF);
+        key >>= 8;
+    }
+    return QString::fromLatin1(chars, CodeLength);
+}
+
+QString TSCCommand::code() const
+{
+    return QString::fromLatin1(codeChars, CodeLength);
+}
+
+void TSCCommand::setCode(const QString &code)
+{
+    Q_ASSERT(isValidCode(code));
+    for (int i = 0; i < CodeLength; i++)
+        codeChars[i] = i < code.size() ? code[i].toLatin1() : ' ';
+}
+
+quint32 TSCCommand::codeKey() const
+{
+    quint32 key = 0;
+    for (int i = 0; i < CodeLength; i++)
+        key = (key << 8) | static_cast<uchar>(codeChars[i]);
+    return key;
+}
+
+void TSCCommand::setCodeKey(quint32 key)
+{
+    for (int i = CodeLength - 1; i >= 0; i--) {
+        codeChars[i] = static_cast<char>(key & 0xFF);
+        key >>= 8;
+    }
+}
+
+int TSCCommand::paramCount() const
+{
+    int count = 0;
+    while (count < MaxParams && params[count].type != None)
+        count++;
+    return count;
+}
+
+QString TSCCommand::description() const
+{
+    if (descSource)
+        return descSource->text(descSpan);
+    return desc;
+}
+
+void TSCCommand::setDescription(const QString &description)
+{
+    desc = description;
+    descSource.reset();
+    descSpan = 0;
+}
+
+void TSCCommand::setDescriptionSource(const QExplicitlySharedDataPointer<TSCTextBuffer> &source, int span)
+{
+    desc = QString();
+    descSource = source;
+    descSpan = span;
+}
+
+void TSCCommand::decodeDescription()
+{
+    if (descSource)
+        setDescription(description());
+}
+
+QByteArray TSCCommand::descriptionUtf8() const
+{
+    if (descSource)
+        return QByteArray::fromRawData(descSource->spanData(descSpan), descSource->spanSize(descSpan));
+    return desc.toUtf8();
+}
+
+bool TSCCommand::hasSameDescription(const TSCCommand &other) const
 {
-    endsEvent = false;
-    clearsTextbox = false;
-    paramsAreSeparated = true;
-    params.clear();
-    for (int i = 0; i < 4; i++)
-        params += QPair<ParameterType, uint>(None, 4);
+    if (descSource && other.descSource) {
+        if (descSource == other.descSource && descSpan == other.descSpan)
+            return true;
+        int size = descSource->spanSize(descSpan);
+        return size == other.descSource->spanSize(other.descSpan)
+                && std::memcmp(descSource->spanData(descSpan), other.descSource->spanData(other.descSpan), static_cast<size_t>(size)) == 0;
+    }
+    return description() == other.description();
 }
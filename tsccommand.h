@@ -2,10 +2,19 @@
 #define TSCCOMMAND_H
 
 #include <QObject>
+#include <QExplicitlySharedDataPointer>
+#include <array>
+#include "tsctextbuffer.h"
 
-class TSCCommand : public QObject
+// Plain value type, stored contiguously (see TSCCommandTable).
+// The code is always 4 Latin-1 characters and lives inline, as do the
+// (always 4) parameters; the boolean properties are packed into one byte.
+// Descriptions of loaded commands stay UTF-8 bytes inside the file buffer
+// they came from (a TSCTextBuffer) until something actually asks for them.
+
+class TSCCommand
 {
-    Q_OBJECT
+    Q_GADGET
 public:
     enum ParameterType : char {
         None = '-',
@@ -32,17 +41,125 @@ public:
     };
     Q_ENUM(ParameterType);
 
+    // what a parameter type character stands for, see paramTypeClasses
+    enum ParameterClass : quint8 {
+        InvalidParameter,
+        NoParameter,
+        ValueParameter,
+    };
+
+    struct Parameter {
+        ParameterType type;
+        quint8 length;
+    };
+
+    static const int CodeLength = 4;
+    static const int MaxParams = 4;
+
     static const QList<QPair<ParameterType, QString>> paramTypeNames;
 
-    explicit TSCCommand(QObject *parent = nullptr);
-    QString code;
+    TSCCommand();
+
+    static constexpr ParameterClass parameterClass(char type);
+    static constexpr bool isValidParameterType(char type);
+    static bool isValidCode(const QString &code);
+    // why code isn't valid, for showing to the user; empty if it is
+    static QString codeProblem(const QString &code);
+    static quint32 codeKey(const QString &code);
+    static QString codeFromKey(quint32 key);
+
+    QString code() const;
+    void setCode(const QString &code);
+    // code packed big-endian, so comparing keys orders the same as comparing codes
+    quint32 codeKey() const;
+    void setCodeKey(quint32 key);
+
+    bool endsEvent() const { return flags & EndsEventFlag; }
+    void setEndsEvent(bool b) { setFlag(EndsEventFlag, b); }
+    bool clearsTextbox() const { return flags & ClearsTextboxFlag; }
+    void setClearsTextbox(bool b) { setFlag(ClearsTextboxFlag, b); }
+    bool paramsAreSeparated() const { return flags & ParamsAreSeparatedFlag; }
+    void setParamsAreSeparated(bool b) { setFlag(ParamsAreSeparatedFlag, b); }
+
+    int paramCount() const;
+
+    // raw flag bits, for binary serialization
+    quint8 packedFlags() const { return flags; }
+    void setPackedFlags(quint8 packed) { flags = static_cast<quint8>(packed & (EndsEventFlag | ClearsTextboxFlag | ParamsAreSeparatedFlag)); }
+
+    // with a source, decoded on first use and cached there for every copy of the command
+    QString description() const;
+    void setDescription(const QString &description);
+    // refers to a span of source, which stays alive for as long as any command still refers to it
+    void setDescriptionSource(const QExplicitlySharedDataPointer<TSCTextBuffer> &source, int span);
+    bool hasDescriptionSource() const { return descSource; }
+    // takes a copy of the description of its own, dropping the source reference
+    void decodeDescription();
+    // straight from the source bytes if there is one; that doesn't copy them, so it's only valid as long as this command is
+    QByteArray descriptionUtf8() const;
+    // compares the source bytes instead of decoding, where possible
+    bool hasSameDescription(const TSCCommand &other) const;
+    // in UTF-8 bytes with a source, UTF-16 code units without; fine for size estimates
+    int descriptionSizeHint() const { return descSource ? descSource->spanSize(descSpan) : desc.size(); }
+
+    Parameter params[MaxParams];
     QString name;
-    QString description;
-    QList<QPair<ParameterType, uint>> params;
-    bool endsEvent;
-    bool clearsTextbox;
-    bool paramsAreSeparated;
+
+private:
+    enum FlagBit : quint8 {
+        EndsEventFlag = 0x1,
+        ClearsTextboxFlag = 0x2,
+        ParamsAreSeparatedFlag = 0x4,
+    };
+
+    char codeChars[CodeLength];
+    quint8 flags;
+    QString desc;
+    QExplicitlySharedDataPointer<TSCTextBuffer> descSource;
+    int descSpan;
+
+    void setFlag(FlagBit bit, bool b)
+    {
+        if (b)
+            flags |= bit;
+        else
+            flags &= static_cast<quint8>(~bit);
+    }
 };
-typedef QSharedPointer<TSCCommand> TSCCommandPtr;
+Q_DECLARE_TYPEINFO(TSCCommand, Q_MOVABLE_TYPE);
+
+namespace TSCCommandTables {
+
+constexpr std::array<TSCCommand::ParameterClass, 256> makeParameterClasses()
+{
+    std::array<TSCCommand::ParameterClass, 256> classes {};
+    for (char type : { TSCCommand::Weapon, TSCCommand::Ammo, TSCCommand::Direction, TSCCommand::Event,
+                       TSCCommand::Equip, TSCCommand::Face, TSCCommand::Flag, TSCCommand::Graphic,
+                       TSCCommand::Illustration, TSCCommand::Item, TSCCommand::Map, TSCCommand::Music,
+                       TSCCommand::NPCNumber, TSCCommand::NPCType, TSCCommand::Sound, TSCCommand::Tile,
+                       TSCCommand::XCoord, TSCCommand::YCoord, TSCCommand::Number, TSCCommand::Ticks })
+        classes[static_cast<uchar>(type)] = TSCCommand::ValueParameter;
+    classes[static_cast<uchar>(TSCCommand::None)] = TSCCommand::NoParameter;
+    return classes;
+}
+
+// indexed by the type character, so checking a type is a single load
+inline constexpr std::array<TSCCommand::ParameterClass, 256> paramTypeClasses = makeParameterClasses();
+
+}
+
+constexpr TSCCommand::ParameterClass TSCCommand::parameterClass(char type)
+{
+    return TSCCommandTables::paramTypeClasses[static_cast<uchar>(type)];
+}
+
+constexpr bool TSCCommand::isValidParameterType(char type)
+{
+    return parameterClass(type) != InvalidParameter;
+}
+
+static_assert(TSCCommand::isValidParameterType(TSCCommand::None) && TSCCommand::isValidParameterType(TSCCommand::Ticks)
+              && !TSCCommand::isValidParameterType('\0') && !TSCCommand::isValidParameterType('?'),
+              "parameter type table is out of sync with ParameterType");
 
 #endif // TSCCOMMAND_H
@@ -0,0 +1,77 @@
+#include "tsccommandfiltermodel.h"
+
+#include <climits>
+#include "tsctrace.h"
+
+TSCCommandFilterModel::TSCCommandFilterModel(TSCCommandModel *source, QObject *parent) : QSortFilterProxyModel(parent), source(source)
+{
+    // results have to be looked up again whenever the commands change, before QSortFilterProxyModel
+    // filters and sorts the changed rows with them; slots run in the order they were connected,
+    // so these have to come ahead of setSourceModel()
+    connect(source, &QAbstractItemModel::rowsInserted, this, &TSCCommandFilterModel::updateResults);
+    connect(source, &QAbstractItemModel::rowsRemoved, this, &TSCCommandFilterModel::updateResults);
+    connect(source, &QAbstractItemModel::dataChanged, this, &TSCCommandFilterModel::updateResults);
+    connect(source, &QAbstractItemModel::layoutChanged, this, &TSCCommandFilterModel::updateResults);
+    connect(source, &QAbstractItemModel::modelReset, this, &TSCCommandFilterModel::updateResults);
+    setSourceModel(source);
+}
+
+void TSCCommandFilterModel::setQuery(const QString &query)
+{
+    QString trimmed = query.trimmed();
+    if (trimmed == currentQuery)
+        return;
+    currentQuery = trimmed;
+    refresh();
+}
+
+void TSCCommandFilterModel::setSortKeys(const QVector<TSCCommandSorter::SortKey> &sortKeys)
+{
+    keys = sortKeys;
+    refresh();
+}
+
+void TSCCommandFilterModel::refresh()
+{
+    TSC_TRACE("TSCCommandFilterModel::refresh");
+    updateResults();
+    invalidateFilter();
+    sort(currentQuery.isEmpty() && keys.isEmpty() ? -1 : 0);
+}
+
+void TSCCommandFilterModel::updateResults()
+{
+    TSC_TRACE("TSCCommandFilterModel::updateResults");
+    ranks.clear();
+    positions.clear();
+    if (!keys.isEmpty())
+        positions = TSCCommandSorter::positions(source->table().commands(), keys);
+    if (!currentQuery.isEmpty()) {
+        ranks.fill(-1, source->rowCount());
+        const QVector<int> rows = source->search(currentQuery);
+        for (int i = 0; i < rows.size(); i++)
+            ranks[rows[i]] = i;
+    }
+}
+
+bool TSCCommandFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    (void)sourceParent;
+    if (currentQuery.isEmpty())
+        return true;
+    // updateResults() has always run by the time rows get here, this is just to be safe
+    if (sourceRow >= ranks.size())
+        return true;
+    return ranks[sourceRow] >= 0;
+}
+
+bool TSCCommandFilterModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
+{
+    // sort keys beat search relevance; both are plain integer compares here
+    const QVector<int> &order = keys.isEmpty() ? ranks : positions;
+    int l = left.row() < order.size() ? order[left.row()] : INT_MAX;
+    int r = right.row() < order.size() ? order[right.row()] : INT_MAX;
+    if (l != r)
+        return l < r;
+    return left.row() < right.row();
+}
@@ -0,0 +1,45 @@
+#ifndef TSCCOMMANDFILTERMODEL_H
+#define TSCCOMMANDFILTERMODEL_H
+
+#include <QSortFilterProxyModel>
+#include "tsccommandmodel.h"
+#include "tsccommandsorter.h"
+
+// Narrows a TSCCommandModel down to the results of a search query, ranked
+// by TSCCommandIndex, and/or shows it in the order of some sort keys
+// (computed up front by TSCCommandSorter) without touching the file order.
+// With no query and no sort keys, everything is shown in file order.
+
+class TSCCommandFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+public:
+    explicit TSCCommandFilterModel(TSCCommandModel *source, QObject *parent = nullptr);
+
+    QString query() const { return currentQuery; }
+    QVector<TSCCommandSorter::SortKey> sortKeys() const { return keys; }
+    void setSortKeys(const QVector<TSCCommandSorter::SortKey> &sortKeys);
+
+public slots:
+    void setQuery(const QString &query);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+    bool lessThan(const QModelIndex &left, const QModelIndex &right) const override;
+
+private slots:
+    void refresh();
+    // ranks and positions only, for QSortFilterProxyModel to filter and sort source changes with
+    void updateResults();
+
+private:
+    TSCCommandModel *source;
+    QString currentQuery;
+    QVector<TSCCommandSorter::SortKey> keys;
+    // rank of every source row in the current results, -1 if filtered out
+    QVector<int> ranks;
+    // sorted position of every source row, if there are sort keys
+    QVector<int> positions;
+};
+
+#endif // TSCCOMMANDFILTERMODEL_H
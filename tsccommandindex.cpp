@@ -0,0 +1,293 @@
+#include "tsccommandindex.h"
+
+#include <algorithm>
+#include <iterator>
+#include "tsctrace.h"
+
+TSCCommandIndex::TSCCommandIndex(const TSCCommandTable *table) : table(table), deadIds(0), built(false), changes(0)
+{
+}
+
+namespace {
+
+inline quint64 foldCase(QChar c)
+{
+    return c.toCaseFolded().unicode();
+}
+
+// only ever given ASCII, which folds the same way QChar does
+inline quint64 foldCase(char c)
+{
+    return c >= 'A' && c <= 'Z' ? quint64(c - 'A' + 'a') : quint64(c);
+}
+
+}
+
+template <typename Unit>
+void TSCCommandIndex::collectGrams(const Unit *text, int size, int shortest, int longest, QVector<quint64> *grams)
+{
+    // grams are case folded UTF-16 units packed together, tagged with their length
+    quint64 c0 = 0, c1 = 0;
+    for (int i = 0; i < size; i++) {
+        quint64 c2 = foldCase(text[i]);
+        if (shortest <= 1)
+            *grams += (quint64(1) << 48) | c2;
+        if (shortest <= 2 && longest >= 2 && i >= 1)
+            *grams += (quint64(2) << 48) | (c1 << 16) | c2;
+        if (longest >= 3 && i >= 2)
+            *grams += (quint64(3) << 48) | (c0 << 32) | (c1 << 16) | c2;
+        c0 = c1;
+        c1 = c2;
+    }
+}
+
+QVector<quint64> TSCCommandIndex::commandGrams(const TSCCommand &cmd)
+{
+    QVector<quint64> grams;
+    QString code = cmd.code();
+    collectGrams(code.constData(), code.size(), 1, 3, &grams);
+    collectGrams(cmd.name.constData(), cmd.name.size(), 1, 3, &grams);
+    if (cmd.hasDescriptionSource()) {
+        // straight from the file buffer; description() would keep the decoded text around for good
+        const QByteArray utf8 = cmd.descriptionUtf8();
+        const char *bytes = utf8.constData();
+        const int size = utf8.size();
+        if (std::all_of(bytes, bytes + size, [](char c) { return static_cast<uchar>(c) < 0x80; })) {
+            collectGrams(bytes, size, 1, 3, &grams);
+        } else {
+            const QString text = QString::fromUtf8(bytes, size);
+            collectGrams(text.constData(), text.size(), 1, 3, &grams);
+        }
+    } else {
+        const QString text = cmd.description();
+        collectGrams(text.constData(), text.size(), 1, 3, &grams);
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    return grams;
+}
+
+quint32 TSCCommandIndex::addId(int row)
+{
+    quint32 id = static_cast<quint32>(idToRow.size());
+    idToRow += row;
+    // ids only ever grow, so postings stay sorted
+    const QVector<quint64> grams = commandGrams(table->at(row));
+    for (quint64 gram : grams)
+        postings[gram] += id;
+    return id;
+}
+
+void TSCCommandIndex::killId(quint32 id)
+{
+    idToRow[static_cast<int>(id)] = -1;
+    deadIds++;
+}
+
+void TSCCommandIndex::compactIfNeeded()
+{
+    if (deadIds > 1024 && deadIds > rowToId.size())
+        rebuild();
+}
+
+TSCCommandIndex::Postings TSCCommandIndex::build(const QVector<TSCCommand> &commands)
+{
+    TSC_TRACE("TSCCommandIndex::build");
+    Postings built;
+    built.rows = commands.size();
+    for (int row = 0; row < commands.size(); row++) {
+        const QVector<quint64> grams = commandGrams(commands[row]);
+        for (quint64 gram : grams)
+            built.lists[gram] += static_cast<quint32>(row);
+    }
+    return built;
+}
+
+void TSCCommandIndex::install(Postings result)
+{
+    postings.swap(result.lists);
+    idToRow.resize(result.rows);
+    rowToId.resize(result.rows);
+    for (int row = 0; row < result.rows; row++) {
+        idToRow[row] = row;
+        rowToId[row] = static_cast<quint32>(row);
+    }
+    deadIds = 0;
+    built = true;
+}
+
+void TSCCommandIndex::rebuild()
+{
+    TSC_TRACE("TSCCommandIndex::rebuild");
+    install(build(table->commands()));
+}
+
+void TSCCommandIndex::invalidate()
+{
+    changes++;
+    postings.clear();
+    idToRow.clear();
+    rowToId.clear();
+    deadIds = 0;
+    built = false;
+}
+
+void TSCCommandIndex::insertRows(int first, int last)
+{
+    changes++;
+    if (!built)
+        return;
+    rowToId.insert(first, last - first + 1, 0);
+    for (int row = first; row <= last; row++)
+        rowToId[row] = addId(row);
+    for (int row = last + 1; row < rowToId.size(); row++)
+        idToRow[static_cast<int>(rowToId[row])] = row;
+}
+
+void TSCCommandIndex::removeRows(int first, int last)
+{
+    changes++;
+    if (!built)
+        return;
+    for (int row = first; row <= last; row++)
+        killId(rowToId[row]);
+    rowToId.remove(first, last - first + 1);
+    for (int row = first; row < rowToId.size(); row++)
+        idToRow[static_cast<int>(rowToId[row])] = row;
+    compactIfNeeded();
+}
+
+void TSCCommandIndex::insertRows(const QVector<int> &rows)
+{
+    changes++;
+    if (!built)
+        return;
+    QVector<quint32> merged;
+    merged.reserve(rowToId.size() + rows.size());
+    int from = 0;
+    for (int row : rows) {
+        while (merged.size() < row)
+            merged += rowToId[from++];
+        merged += addId(row);
+    }
+    while (from < rowToId.size())
+        merged += rowToId[from++];
+    rowToId.swap(merged);
+    for (int row = rows.isEmpty() ? 0 : rows[0]; row < rowToId.size(); row++)
+        idToRow[static_cast<int>(rowToId[row])] = row;
+}
+
+void TSCCommandIndex::removeRows(const QVector<int> &rows)
+{
+    changes++;
+    if (!built)
+        return;
+    int to = rows.isEmpty() ? rowToId.size() : rows[0];
+    int next = 0;
+    for (int from = to; from < rowToId.size(); from++) {
+        if (next < rows.size() && rows[next] == from) {
+            killId(rowToId[from]);
+            next++;
+            continue;
+        }
+        idToRow[static_cast<int>(rowToId[from])] = to;
+        rowToId[to++] = rowToId[from];
+    }
+    rowToId.resize(to);
+    compactIfNeeded();
+}
+
+void TSCCommandIndex::changeRow(int row)
+{
+    changes++;
+    if (!built)
+        return;
+    killId(rowToId[row]);
+    rowToId[row] = addId(row);
+    compactIfNeeded();
+}
+
+void TSCCommandIndex::moveRows(const QVector<int> &newRows)
+{
+    changes++;
+    if (!built)
+        return;
+    QVector<quint32> moved(rowToId.size());
+    for (int row = 0; row < rowToId.size(); row++)
+        moved[newRows[row]] = rowToId[row];
+    rowToId.swap(moved);
+    for (int row = 0; row < rowToId.size(); row++)
+        idToRow[static_cast<int>(rowToId[row])] = row;
+}
+
+int TSCCommandIndex::score(const TSCCommand &cmd, const QString &query, bool matched)
+{
+    QString code = cmd.code();
+    if (code.compare(query, Qt::CaseInsensitive) == 0)
+        return 1000;
+    if (code.startsWith(query, Qt::CaseInsensitive))
+        return 500;
+    if (code.contains(query, Qt::CaseInsensitive))
+        return 300;
+    if (cmd.name.startsWith(query, Qt::CaseInsensitive))
+        return 200;
+    if (cmd.name.contains(query, Qt::CaseInsensitive))
+        return 100;
+    // the description is only decoded if the grams can't already tell
+    if (matched || cmd.description().contains(query, Qt::CaseInsensitive))
+        return 10;
+    return 0;
+}
+
+QVector<int> TSCCommandIndex::search(const QString &query)
+{
+    TSC_TRACE("TSCCommandIndex::search");
+    QVector<int> rows;
+    if (query.isEmpty())
+        return rows;
+    if (!built)
+        rebuild();
+    // (-score, row), so a plain sort ranks best first and keeps file order for ties
+    QVector<QPair<int, int>> hits;
+    // a single character is its own gram, so everything it finds is a match
+    const bool exact = query.size() == 1;
+    auto consider = [&](int row) {
+        int s = score(table->at(row), query, exact);
+        if (s > 0)
+            hits += qMakePair(-s, row);
+    };
+    const int length = qMin(query.size(), 3);
+    QVector<quint64> grams;
+    collectGrams(query.constData(), query.size(), length, length, &grams);
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    QVector<const QVector<quint32> *> lists;
+    for (quint64 gram : grams) {
+        auto it = postings.constFind(gram);
+        if (it == postings.constEnd())
+            return rows;
+        lists += &it.value();
+    }
+    // intersect starting from the rarest gram
+    std::sort(lists.begin(), lists.end(), [](const QVector<quint32> *a, const QVector<quint32> *b) {
+        return a->size() < b->size();
+    });
+    QVector<quint32> candidates = *lists[0];
+    for (int i = 1; i < lists.size() && !candidates.isEmpty(); i++) {
+        QVector<quint32> next;
+        std::set_intersection(candidates.constBegin(), candidates.constEnd(),
+                              lists[i]->constBegin(), lists[i]->constEnd(), std::back_inserter(next));
+        candidates.swap(next);
+    }
+    // grams only narrow things down, the actual match is checked here
+    for (quint32 id : candidates) {
+        int row = idToRow[static_cast<int>(id)];
+        if (row >= 0)
+            consider(row);
+    }
+    std::sort(hits.begin(), hits.end());
+    rows.reserve(hits.size());
+    for (const QPair<int, int> &hit : hits)
+        rows += hit.second;
+    return rows;
+}
@@ -0,0 +1,71 @@
+#ifndef TSCCOMMANDINDEX_H
+#define TSCCOMMANDINDEX_H
+
+#include <QHash>
+#include <QVector>
+#include "tsccommandtable.h"
+
+// Unigram/bigram/trigram index over the code, name and description of every
+// command in a TSCCommandTable, for as-you-type searching.
+// Postings refer to internal ids rather than rows, so inserting or removing
+// rows doesn't have to touch them; ids of removed or edited rows are just
+// marked dead and swept out once there are enough of them.
+// The whole index can be built from a snapshot of the commands on a worker
+// (see TSCCommandModel::buildSearchIndex()); descriptions still in a file
+// buffer are indexed from their UTF-8, without decoding them for good.
+
+class TSCCommandIndex
+{
+public:
+    // what build() works out, for install()
+    struct Postings {
+        QHash<quint64, QVector<quint32>> lists;
+        int rows = 0;
+    };
+
+    explicit TSCCommandIndex(const TSCCommandTable *table);
+
+    // safe to call from worker threads; ids are rows
+    static Postings build(const QVector<TSCCommand> &commands);
+    // takes over what build() made of the table as it is now
+    void install(Postings result);
+    void rebuild();
+    // drops everything; the next search() builds the index again
+    void invalidate();
+    bool isBuilt() const { return built; }
+    // goes up with every change to the rows, to tell whether a build() is still up to date
+    quint64 revision() const { return changes; }
+    void insertRows(int first, int last);
+    void removeRows(int first, int last);
+    // rows must be in ascending order, as they are after inserting
+    void insertRows(const QVector<int> &rows);
+    void removeRows(const QVector<int> &rows);
+    void changeRow(int row);
+    // newRows maps every old row to its new row
+    void moveRows(const QVector<int> &newRows);
+
+    // matching rows, best match first
+    QVector<int> search(const QString &query);
+
+private:
+    const TSCCommandTable *table;
+    QHash<quint64, QVector<quint32>> postings;
+    QVector<int> idToRow;
+    QVector<quint32> rowToId;
+    int deadIds;
+    bool built;
+    quint64 changes;
+
+    quint32 addId(int row);
+    // sorted and without repeats
+    static QVector<quint64> commandGrams(const TSCCommand &cmd);
+    void killId(quint32 id);
+    void compactIfNeeded();
+    // grams of shortest..longest (at most 3) characters
+    template <typename Unit>
+    static void collectGrams(const Unit *text, int size, int shortest, int longest, QVector<quint64> *grams);
+    // matched: the postings already prove query is in there somewhere
+    static int score(const TSCCommand &cmd, const QString &query, bool matched);
+};
+
+#endif // TSCCOMMANDINDEX_H
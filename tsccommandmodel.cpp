@@ -0,0 +1,299 @@
+#include "tsccommandmodel.h"
+
+#include <QtConcurrent>
+#include <algorithm>
+#include "tscundohistory.h"
+#include "tsctrace.h"
+
+TSCCommandModel::TSCCommandModel(TSCCommandTable *commands, QObject *parent) : QAbstractListModel(parent), commands(commands), searchIndex(commands), indexBuildPending(false), indexBuildRevision(0), history(nullptr), editable(true)
+{
+    connect(&indexBuild, &QFutureWatcherBase::finished, this, &TSCCommandModel::searchIndexBuilt);
+}
+
+int TSCCommandModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return commands->size();
+}
+
+QVariant TSCCommandModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= commands->size())
+        return QVariant();
+    const TSCCommand &cmd = commands->at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString("%1 - %2").arg(cmd.code()).arg(cmd.name);
+    case Qt::ToolTipRole:
+        return cmd.description();
+    case CodeRole:
+        return cmd.code();
+    case NameRole:
+        return cmd.name;
+    default:
+        return QVariant();
+    }
+}
+
+Qt::ItemFlags TSCCommandModel::flags(const QModelIndex &index) const
+{
+    Qt::ItemFlags f = QAbstractListModel::flags(index);
+    if (index.isValid() && editable)
+        f |= Qt::ItemIsEditable;
+    return f;
+}
+
+bool TSCCommandModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    return setItemData(index, { { role, value } });
+}
+
+bool TSCCommandModel::setItemData(const QModelIndex &index, const QMap<int, QVariant> &roles)
+{
+    if (!editable || !index.isValid() || index.row() >= commands->size())
+        return false;
+    const int row = index.row();
+    TSCCommand cmd = commands->at(row);
+    for (auto it = roles.constBegin(); it != roles.constEnd(); ++it) {
+        switch (it.key()) {
+        case CodeRole: {
+            QString code = it.value().toString();
+            if (!TSCCommand::isValidCode(code))
+                return false;
+            cmd.setCode(code);
+            if (commands->conflictingRow(cmd.codeKey(), row) >= 0)
+                return false;
+            break;
+        }
+        case NameRole:
+            cmd.name = it.value().toString();
+            break;
+        default:
+            return false;
+        }
+    }
+    const TSCCommand &old = commands->at(row);
+    if (cmd.codeKey() != old.codeKey() || cmd.name != old.name)
+        replaceCommand(row, cmd);
+    return true;
+}
+
+QVector<int> TSCCommandModel::search(const QString &query) const
+{
+    // waiting for the rest of a build beats doing all of it again here
+    if (indexBuildPending) {
+        indexBuildPending = false;
+        indexBuild.waitForFinished();
+        if (searchIndex.revision() == indexBuildRevision)
+            searchIndex.install(indexBuild.result());
+    }
+    return searchIndex.search(query);
+}
+
+void TSCCommandModel::buildSearchIndex()
+{
+    // the vector is implicitly shared, so this is a cheap but consistent snapshot
+    const QVector<TSCCommand> snapshot = commands->commands();
+    indexBuildRevision = searchIndex.revision();
+    indexBuildPending = true;
+    indexBuild.setFuture(QtConcurrent::run([snapshot]() {
+        return TSCCommandIndex::build(snapshot);
+    }));
+}
+
+void TSCCommandModel::searchIndexBuilt()
+{
+    // a search may have taken it already
+    if (!indexBuildPending)
+        return;
+    if (searchIndex.revision() != indexBuildRevision) {
+        buildSearchIndex();
+        return;
+    }
+    indexBuildPending = false;
+    searchIndex.install(indexBuild.result());
+}
+
+void TSCCommandModel::setCommands(TSCCommandTable newCommands)
+{
+    TSC_TRACE("TSCCommandModel::setCommands");
+    beginResetModel();
+    *commands = std::move(newCommands);
+    searchIndex.invalidate();
+    endResetModel();
+    if (history)
+        history->clear();
+}
+
+int TSCCommandModel::appendCommand(const TSCCommand &cmd)
+{
+    int row = commands->size();
+    insertCommand(row, cmd);
+    return row;
+}
+
+void TSCCommandModel::appendCommands(const QVector<TSCCommand> &cmds)
+{
+    if (cmds.isEmpty())
+        return;
+    int first = commands->size();
+    int last = first + cmds.size() - 1;
+    beginInsertRows(QModelIndex(), first, last);
+    for (const TSCCommand &cmd : cmds)
+        commands->append(cmd);
+    searchIndex.insertRows(first, last);
+    endInsertRows();
+    if (history) {
+        history->beginGroup("Add commands");
+        for (int row = first; row <= last; row++)
+            history->recordInsert(row);
+        history->endGroup();
+    }
+}
+
+void TSCCommandModel::insertCommand(int row, const TSCCommand &cmd)
+{
+    beginInsertRows(QModelIndex(), row, row);
+    commands->insert(row, cmd);
+    searchIndex.insertRows(row, row);
+    endInsertRows();
+    if (history)
+        history->recordInsert(row);
+}
+
+void TSCCommandModel::removeCommand(int row)
+{
+    TSCCommand old = commands->at(row);
+    beginRemoveRows(QModelIndex(), row, row);
+    commands->removeAt(row);
+    searchIndex.removeRows(row, row);
+    endRemoveRows();
+    if (history)
+        history->recordRemove(row, old);
+}
+
+void TSCCommandModel::replaceCommand(int row, const TSCCommand &cmd)
+{
+    TSCCommand old = commands->at(row);
+    commands->replace(row, cmd);
+    searchIndex.changeRow(row);
+    QModelIndex changed = index(row);
+    emit dataChanged(changed, changed);
+    if (history)
+        history->recordReplace(row, old);
+}
+
+void TSCCommandModel::insertCommands(const QVector<int> &rows, const QVector<TSCCommand> &cmds)
+{
+    TSC_TRACE("TSCCommandModel::insertCommands");
+    if (rows.isEmpty())
+        return;
+    // views can only be told about one range of rows at a time, so scattered rows are a layout
+    // change instead; either way, selections, the current row and the scroll position survive
+    bool contiguous = rows.last() - rows.first() + 1 == rows.size();
+    if (contiguous)
+        beginInsertRows(QModelIndex(), rows.first(), rows.last());
+    else
+        emit layoutAboutToBeChanged();
+    commands->insertRows(rows, cmds);
+    searchIndex.insertRows(rows);
+    if (contiguous) {
+        endInsertRows();
+    } else {
+        // an old row moves down by every new command that has no more old rows in front of it than it does
+        QVector<int> oldRowsBefore(rows.size());
+        for (int i = 0; i < rows.size(); i++)
+            oldRowsBefore[i] = rows[i] - i;
+        const QModelIndexList persistent = persistentIndexList();
+        for (const QModelIndex &old : persistent) {
+            int shift = static_cast<int>(std::upper_bound(oldRowsBefore.constBegin(), oldRowsBefore.constEnd(), old.row()) - oldRowsBefore.constBegin());
+            changePersistentIndex(old, index(old.row() + shift));
+        }
+        emit layoutChanged();
+    }
+    if (history)
+        history->recordInsertRows(rows);
+}
+
+void TSCCommandModel::removeCommands(const QVector<int> &rows)
+{
+    TSC_TRACE("TSCCommandModel::removeCommands");
+    if (rows.isEmpty())
+        return;
+    QVector<TSCCommand> old;
+    if (history) {
+        old.reserve(rows.size());
+        for (int row : rows)
+            old += commands->at(row);
+    }
+    // see insertCommands()
+    bool contiguous = rows.last() - rows.first() + 1 == rows.size();
+    if (contiguous)
+        beginRemoveRows(QModelIndex(), rows.first(), rows.last());
+    else
+        emit layoutAboutToBeChanged();
+    commands->removeRows(rows);
+    searchIndex.removeRows(rows);
+    if (contiguous) {
+        endRemoveRows();
+    } else {
+        const QModelIndexList persistent = persistentIndexList();
+        for (const QModelIndex &old : persistent) {
+            auto removed = std::lower_bound(rows.constBegin(), rows.constEnd(), old.row());
+            if (removed != rows.constEnd() && *removed == old.row())
+                changePersistentIndex(old, QModelIndex());
+            else
+                changePersistentIndex(old, index(old.row() - static_cast<int>(removed - rows.constBegin())));
+        }
+        emit layoutChanged();
+    }
+    if (history)
+        history->recordRemoveRows(rows, old);
+}
+
+void TSCCommandModel::replaceCommands(const QVector<int> &rows, const QVector<TSCCommand> &cmds)
+{
+    TSC_TRACE("TSCCommandModel::replaceCommands");
+    if (rows.isEmpty())
+        return;
+    QVector<TSCCommand> old;
+    if (history)
+        old.reserve(rows.size());
+    for (int i = 0; i < rows.size(); i++) {
+        if (history)
+            old += commands->at(rows[i]);
+        commands->replace(rows[i], cmds[i]);
+        searchIndex.changeRow(rows[i]);
+    }
+    emit dataChanged(index(rows.first()), index(rows.last()));
+    if (history)
+        history->recordReplaceRows(rows, old);
+}
+
+void TSCCommandModel::permuteRows(const QVector<int> &newRows)
+{
+    TSC_TRACE("TSCCommandModel::permuteRows");
+    emit layoutAboutToBeChanged();
+    commands->permute(newRows);
+    searchIndex.moveRows(newRows);
+    const QModelIndexList persistent = persistentIndexList();
+    for (const QModelIndex &old : persistent)
+        changePersistentIndex(old, index(newRows[old.row()]));
+    emit layoutChanged();
+    if (history)
+        history->recordMove(newRows);
+}
+
+void TSCCommandModel::sortByCode()
+{
+    TSC_TRACE("TSCCommandModel::sortByCode");
+    QVector<int> newRows = commands->sortedRows();
+    for (int row = 0; row < newRows.size(); row++) {
+        // only touch the view (and the undo history) if something actually moves
+        if (newRows[row] != row) {
+            permuteRows(newRows);
+            return;
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef TSCCOMMANDMODEL_H
+#define TSCCOMMANDMODEL_H
+
+#include <QAbstractListModel>
+#include <QFutureWatcher>
+#include "tsccommandtable.h"
+#include "tsccommandindex.h"
+
+class TSCUndoHistory;
+
+// List model that reads straight from a TSCCommandTable.
+// All modifications to the table should go through here, so views only
+// get notified about (and only repaint) the rows that actually changed.
+
+class TSCCommandModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Roles {
+        CodeRole = Qt::UserRole + 1,
+        NameRole,
+    };
+
+    explicit TSCCommandModel(TSCCommandTable *commands, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    // only CodeRole and NameRole can be set; all of them go through replaceCommand() together,
+    // and a code that's invalid or already taken makes the whole thing fail
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    bool setItemData(const QModelIndex &index, const QMap<int, QVariant> &roles) override;
+
+    const TSCCommandTable &table() const { return *commands; }
+    // matching rows, best match first
+    QVector<int> search(const QString &query) const;
+    // builds the search index from the rows as they are now, on a worker; a search
+    // before it's done waits for it, rows changed meanwhile make it start over
+    void buildSearchIndex();
+
+    // changes made from here on are recorded into history
+    void setHistory(TSCUndoHistory *history) { this->history = history; }
+    // whether views may edit rows in place (see flags()); not while the list is still loading
+    bool isEditable() const { return editable; }
+    void setEditable(bool editable) { this->editable = editable; }
+
+    void setCommands(TSCCommandTable newCommands);
+    int appendCommand(const TSCCommand &cmd);
+    void appendCommands(const QVector<TSCCommand> &cmds);
+    void insertCommand(int row, const TSCCommand &cmd);
+    void removeCommand(int row);
+    void replaceCommand(int row, const TSCCommand &cmd);
+    // batch versions, each a single update to the table, index and views
+    // (and a single undo step); rows must be in ascending order
+    void insertCommands(const QVector<int> &rows, const QVector<TSCCommand> &cmds);
+    void removeCommands(const QVector<int> &rows);
+    void replaceCommands(const QVector<int> &rows, const QVector<TSCCommand> &cmds);
+    // newRows maps every old row to its new row
+    void permuteRows(const QVector<int> &newRows);
+    void sortByCode();
+
+private:
+    TSCCommandTable *commands;
+    // see buildSearchIndex(); otherwise built on the first search, hence mutable
+    mutable TSCCommandIndex searchIndex;
+    mutable QFutureWatcher<TSCCommandIndex::Postings> indexBuild;
+    mutable bool indexBuildPending;
+    quint64 indexBuildRevision;
+    TSCUndoHistory *history;
+    bool editable;
+
+    void searchIndexBuilt();
+};
+
+#endif // TSCCOMMANDMODEL_H
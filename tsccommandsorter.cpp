@@ -0,0 +1,83 @@
+#include "tsccommandsorter.h"
+#include "tsctrace.h"
+
+#include <algorithm>
+
+namespace {
+
+// one stable counting sort pass; keyOf(row) must be in [0, 256)
+template <typename KeyOf>
+void countingPass(QVector<int> &order, QVector<int> &scratch, KeyOf keyOf)
+{
+    int counts[257] = {};
+    for (int row : qAsConst(order))
+        counts[keyOf(row) + 1]++;
+    // everything in one bucket (all codes starting with '<', say): nothing to do
+    for (int i = 1; i <= 256; i++) {
+        if (counts[i] == order.size())
+            return;
+    }
+    for (int i = 0; i < 256; i++)
+        counts[i + 1] += counts[i];
+    for (int row : qAsConst(order))
+        scratch[counts[keyOf(row)]++] = row;
+    order.swap(scratch);
+}
+
+}
+
+QVector<int> TSCCommandSorter::order(const QVector<TSCCommand> &commands, const QVector<SortKey> &keys)
+{
+    TSC_TRACE("TSCCommandSorter::order");
+    QVector<int> order(commands.size());
+    for (int i = 0; i < order.size(); i++)
+        order[i] = i;
+    QVector<int> scratch(commands.size());
+    // least significant key first; each pass keeps the order of the ones before it for ties
+    for (int i = keys.size() - 1; i >= 0; i--) {
+        const bool descending = keys[i].order == Qt::DescendingOrder;
+        switch (keys[i].key) {
+        case Code: {
+            QVector<quint32> codeKeys(commands.size());
+            for (int row = 0; row < commands.size(); row++)
+                codeKeys[row] = commands[row].codeKey();
+            // keys are packed big-endian, so the last character is the lowest byte
+            for (int shift = 0; shift < 32; shift += 8) {
+                countingPass(order, scratch, [&codeKeys, shift, descending](int row) {
+                    int byte = static_cast<int>((codeKeys[row] >> shift) & 0xFF);
+                    return descending ? 0xFF - byte : byte;
+                });
+            }
+            break;
+        }
+        case Name:
+            std::stable_sort(order.begin(), order.end(), [&commands, descending](int a, int b) {
+                if (descending)
+                    std::swap(a, b);
+                return QString::compare(commands[a].name, commands[b].name, Qt::CaseInsensitive) < 0;
+            });
+            break;
+        case ParamCount:
+            countingPass(order, scratch, [&commands, descending](int row) {
+                int count = commands[row].paramCount();
+                return descending ? TSCCommand::MaxParams - count : count;
+            });
+            break;
+        case EndsEvent:
+            countingPass(order, scratch, [&commands, descending](int row) {
+                return commands[row].endsEvent() != descending ? 1 : 0;
+            });
+            break;
+        }
+    }
+    return order;
+}
+
+QVector<int> TSCCommandSorter::positions(const QVector<TSCCommand> &commands, const QVector<SortKey> &keys)
+{
+    const QVector<int> sorted = order(commands, keys);
+    QVector<int> positions(sorted.size());
+    for (int i = 0; i < sorted.size(); i++)
+        positions[sorted[i]] = i;
+    return positions;
+}
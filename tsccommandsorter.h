@@ -0,0 +1,37 @@
+#ifndef TSCCOMMANDSORTER_H
+#define TSCCOMMANDSORTER_H
+
+#include <QVector>
+#include "tsccommand.h"
+
+// Orders commands by any combination of keys without moving them; the result
+// is a permutation of rows, for views (TSCCommandFilterModel) to show.
+// Codes are compared as packed integers, radix sorted a byte at a time, and
+// the small integer keys are counting sorted, so only names need actual
+// comparisons. Every pass is stable, so rows that compare equal on all keys
+// stay in file order.
+
+class TSCCommandSorter
+{
+public:
+    enum Key : quint8 {
+        Code,
+        Name,
+        ParamCount,
+        EndsEvent,
+    };
+
+    struct SortKey {
+        Key key;
+        Qt::SortOrder order;
+    };
+
+    // rows in sorted order; the first key matters most
+    static QVector<int> order(const QVector<TSCCommand> &commands, const QVector<SortKey> &keys);
+    // sorted position of every row, i.e. the inverse of order()
+    static QVector<int> positions(const QVector<TSCCommand> &commands, const QVector<SortKey> &keys);
+};
+
+Q_DECLARE_TYPEINFO(TSCCommandSorter::SortKey, Q_PRIMITIVE_TYPE);
+
+#endif // TSCCOMMANDSORTER_H
@@ -0,0 +1,132 @@
+#include "tsccommandtable.h"
+#include "tsccommandsorter.h"
+
+int TSCCommandTable::indexOf(const QString &code) const
+{
+    if (!TSCCommand::isValidCode(code))
+        return -1;
+    return indexOf(TSCCommand::codeKey(code));
+}
+
+int TSCCommandTable::indexOf(quint32 codeKey) const
+{
+    int row = -1;
+    for (auto it = index.constFind(codeKey); it != index.constEnd() && it.key() == codeKey; ++it) {
+        if (row < 0 || it.value() < row)
+            row = it.value();
+    }
+    return row;
+}
+
+int TSCCommandTable::conflictingRow(quint32 codeKey, int ignoreRow) const
+{
+    for (auto it = index.constFind(codeKey); it != index.constEnd() && it.key() == codeKey; ++it) {
+        if (it.value() != ignoreRow)
+            return it.value();
+    }
+    return -1;
+}
+
+void TSCCommandTable::clear()
+{
+    cmds.clear();
+    index.clear();
+}
+
+void TSCCommandTable::reserve(int size)
+{
+    cmds.reserve(size);
+    index.reserve(size);
+}
+
+void TSCCommandTable::append(const TSCCommand &cmd)
+{
+    index.insert(cmd.codeKey(), cmds.size());
+    cmds += cmd;
+}
+
+void TSCCommandTable::insert(int row, const TSCCommand &cmd)
+{
+    // everything from the inserted row on moves down by one
+    for (auto it = index.begin(); it != index.end(); ++it) {
+        if (it.value() >= row)
+            ++it.value();
+    }
+    index.insert(cmd.codeKey(), row);
+    cmds.insert(row, cmd);
+}
+
+void TSCCommandTable::removeAt(int row)
+{
+    index.remove(cmds[row].codeKey(), row);
+    cmds.removeAt(row);
+    // everything after the removed row moves up by one
+    for (auto it = index.begin(); it != index.end(); ++it) {
+        if (it.value() > row)
+            --it.value();
+    }
+}
+
+void TSCCommandTable::insertRows(const QVector<int> &rows, const QVector<TSCCommand> &newCmds)
+{
+    // merge everything in one pass, then renumber once
+    QVector<TSCCommand> merged;
+    merged.reserve(cmds.size() + newCmds.size());
+    int from = 0;
+    for (int i = 0; i < rows.size(); i++) {
+        while (merged.size() < rows[i])
+            merged += std::move(cmds[from++]);
+        merged += newCmds[i];
+    }
+    while (from < cmds.size())
+        merged += std::move(cmds[from++]);
+    cmds.swap(merged);
+    rebuildIndex();
+}
+
+void TSCCommandTable::removeRows(const QVector<int> &rows)
+{
+    int to = rows.isEmpty() ? cmds.size() : rows[0];
+    int next = 0;
+    for (int from = to; from < cmds.size(); from++) {
+        if (next < rows.size() && rows[next] == from) {
+            next++;
+            continue;
+        }
+        cmds[to++] = std::move(cmds[from]);
+    }
+    cmds.resize(to);
+    rebuildIndex();
+}
+
+void TSCCommandTable::replace(int row, const TSCCommand &cmd)
+{
+    quint32 oldKey = cmds[row].codeKey();
+    if (oldKey != cmd.codeKey()) {
+        index.remove(oldKey, row);
+        index.insert(cmd.codeKey(), row);
+    }
+    cmds[row] = cmd;
+}
+
+void TSCCommandTable::permute(const QVector<int> &newRows)
+{
+    QVector<TSCCommand> moved(cmds.size());
+    for (int row = 0; row < cmds.size(); row++)
+        moved[newRows[row]] = std::move(cmds[row]);
+    cmds.swap(moved);
+    rebuildIndex();
+}
+
+QVector<int> TSCCommandTable::sortedRows() const
+{
+    return TSCCommandSorter::positions(cmds, { { TSCCommandSorter::Code, Qt::AscendingOrder } });
+}
+
+void TSCCommandTable::rebuildIndex()
+{
+    index.clear();
+    index.reserve(cmds.size());
+    for (int i = 0; i < cmds.size(); i++)
+        index.insert(cmds[i].codeKey(), i);
+}
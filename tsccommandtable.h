@@ -0,0 +1,47 @@
+#ifndef TSCCOMMANDTABLE_H
+#define TSCCOMMANDTABLE_H
+
+#include <QVector>
+#include <QMultiHash>
+#include "tsccommand.h"
+
+// Owns a document's commands and keeps a hash index from (packed) code to
+// row, so lookups and conflict checks don't have to walk the whole list.
+// Codes are expected to be unique, but the index tolerates duplicates
+// (e.g. adding several "<NEW" commands in a row).
+
+class TSCCommandTable
+{
+public:
+    int size() const { return cmds.size(); }
+    bool isEmpty() const { return cmds.isEmpty(); }
+    const TSCCommand &at(int row) const { return cmds.at(row); }
+    const QVector<TSCCommand> &commands() const { return cmds; }
+
+    int indexOf(const QString &code) const;
+    int indexOf(quint32 codeKey) const;
+    int conflictingRow(quint32 codeKey, int ignoreRow = -1) const;
+
+    void clear();
+    void reserve(int size);
+    void append(const TSCCommand &cmd);
+    void insert(int row, const TSCCommand &cmd);
+    void removeAt(int row);
+    // rows must be in ascending order; for insertRows(), these are the rows
+    // the commands end up at
+    void insertRows(const QVector<int> &rows, const QVector<TSCCommand> &newCmds);
+    void removeRows(const QVector<int> &rows);
+    void replace(int row, const TSCCommand &cmd);
+    // newRows maps every old row to its new row
+    void permute(const QVector<int> &newRows);
+    // the new row of every old row, if the table were sorted by code
+    QVector<int> sortedRows() const;
+
+private:
+    QVector<TSCCommand> cmds;
+    QMultiHash<quint32, int> index;
+
+    void rebuildIndex();
+};
+
+#endif // TSCCOMMANDTABLE_H
@@ -0,0 +1,140 @@
+#include "tscdocument.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent>
+#include <numeric>
+#include "tsclistparser.h"
+#include "tsclistcache.h"
+#include "tsclistdiff.h"
+#include "tsctrace.h"
+
+TSCDocument::TSCDocument(QObject *parent) : QObject(parent), savedHash(0), unsavedMods(false), loading(false)
+{
+    cmdModel = new TSCCommandModel(&table, this);
+    cmdFilter = new TSCCommandFilterModel(cmdModel, this);
+    undoHistory = new TSCUndoHistory(cmdModel, this);
+    cmdModel->setHistory(undoHistory);
+    connect(undoHistory, &TSCUndoHistory::changed, this, &TSCDocument::historyChanged);
+}
+
+TSCDocument::LoadResult TSCDocument::readFile(const QString &fileName, bool useCache, const TSCListParser::BatchHandler &onBatch)
+{
+    TSC_TRACE("TSCDocument::readFile");
+    LoadResult result;
+    if (!useCache || !TSCListCache::load(fileName, &result.commands, &result.contentHash)) {
+        QFile src(fileName);
+        if (!TSCListParser::parseFile(&src, &result.commands, &result.message, &result.contentHash, onBatch))
+            return result;
+        if (useCache) {
+            // nobody's waiting on this, so don't hold up the load for it
+            QVector<TSCCommand> snapshot = result.commands.commands();
+            quint64 contentHash = result.contentHash;
+            QtConcurrent::run([fileName, snapshot, contentHash]() {
+                TSCListCache::save(fileName, snapshot, contentHash);
+            });
+        }
+    }
+    result.ok = true;
+    result.message = QString("Successfully loaded %1 commands from \"%2\"").arg(result.commands.size()).arg(fileName);
+    return result;
+}
+
+void TSCDocument::beginLoading()
+{
+    loading = true;
+    cmdModel->setEditable(false);
+    emit stateChanged();
+}
+
+void TSCDocument::appendLoaded(const QVector<TSCCommand> &batch)
+{
+    cmdModel->setHistory(nullptr);
+    cmdModel->appendCommands(batch);
+    cmdModel->setHistory(undoHistory);
+}
+
+void TSCDocument::finishLoading(const TSCCommandTable &commands)
+{
+    // the batches normally add up to the whole list already; cache loads don't come in batches
+    if (table.size() != commands.size())
+        cmdModel->setCommands(commands);
+    // ready by the time anybody types a query, without holding this thread up
+    cmdModel->buildSearchIndex();
+    undoHistory->clear();
+    loading = false;
+    cmdModel->setEditable(true);
+    emit stateChanged();
+}
+
+int TSCDocument::applyExternalChange(const TSCCommandTable &newCommands, const QString &text)
+{
+    QVector<TSCListDiff::Edit> edits;
+    undoHistory->beginGroup(text);
+    if (!TSCListDiff::diff(table.commands(), newCommands.commands(), &edits)) {
+        // too different to diff, so swap out every row; still a single step that can be undone
+        QVector<int> oldRows(table.size()), newRows(newCommands.size());
+        std::iota(oldRows.begin(), oldRows.end(), 0);
+        std::iota(newRows.begin(), newRows.end(), 0);
+        cmdModel->removeCommands(oldRows);
+        cmdModel->insertCommands(newRows, newCommands.commands());
+        undoHistory->endGroup();
+        return newCommands.size();
+    }
+    // one edit at a time would renumber the table and the search index for every one of them, so sort them
+    // into a batch of each kind: replaces and removes by their row before the change, inserts by their row after it
+    QVector<int> replaceRows, removeRows, insertRows;
+    QVector<TSCCommand> replaceCmds, insertCmds;
+    int shift = 0;
+    for (const TSCListDiff::Edit &edit : qAsConst(edits)) {
+        switch (edit.kind) {
+        case TSCListDiff::Edit::Insert:
+            insertRows += edit.row;
+            insertCmds += newCommands.at(edit.source);
+            shift++;
+            break;
+        case TSCListDiff::Edit::Remove:
+            removeRows += edit.row - shift;
+            shift--;
+            break;
+        case TSCListDiff::Edit::Replace:
+            replaceRows += edit.row - shift;
+            replaceCmds += newCommands.at(edit.source);
+            break;
+        }
+    }
+    cmdModel->replaceCommands(replaceRows, replaceCmds);
+    cmdModel->removeCommands(removeRows);
+    cmdModel->insertCommands(insertRows, insertCmds);
+    undoHistory->endGroup();
+    return edits.size();
+}
+
+void TSCDocument::setFileName(const QString &fileName)
+{
+    path = fileName;
+    emit stateChanged();
+}
+
+QString TSCDocument::displayName() const
+{
+    if (path.isEmpty())
+        return "Untitled";
+    return QFileInfo(path).fileName();
+}
+
+void TSCDocument::setUnsavedMods(bool unsaved)
+{
+    // historyChanged() picks this up
+    if (unsaved)
+        undoHistory->resetClean();
+    else
+        undoHistory->setClean();
+}
+
+void TSCDocument::historyChanged()
+{
+    // always emitted, so the undo/redo actions stay up to date
+    unsavedMods = !undoHistory->isClean();
+    emit stateChanged();
+}
@@ -0,0 +1,72 @@
+#ifndef TSCDOCUMENT_H
+#define TSCDOCUMENT_H
+
+#include <QObject>
+#include "tsccommandmodel.h"
+#include "tsccommandfiltermodel.h"
+#include "tscundohistory.h"
+#include "tsclistparser.h"
+
+// One open tsc_list, with everything that belongs to it: its commands, the
+// models views use to show them, and where (and whether) it was saved.
+
+class TSCDocument : public QObject
+{
+    Q_OBJECT
+public:
+    struct LoadResult {
+        bool ok = false;
+        QString message;
+        TSCCommandTable commands;
+        // TSCListCache::hash() of the file
+        quint64 contentHash = 0;
+    };
+
+    explicit TSCDocument(QObject *parent = nullptr);
+
+    // safe to call from worker threads; onBatch is only called if the list has to be parsed
+    static LoadResult readFile(const QString &fileName, bool useCache, const TSCListParser::BatchHandler &onBatch = TSCListParser::BatchHandler());
+
+    // for showing a list while it's still being read; none of this is undoable
+    bool isLoading() const { return loading; }
+    void beginLoading();
+    void appendLoaded(const QVector<TSCCommand> &batch);
+    void finishLoading(const TSCCommandTable &commands);
+
+    // applies the difference to newCommands as a single undoable step,
+    // falling back to replacing every row (still in that one step) if it's too big; returns the number of changed rows
+    int applyExternalChange(const TSCCommandTable &newCommands, const QString &text = "Reload from disk");
+
+    const TSCCommandTable &commands() const { return table; }
+    TSCCommandModel *model() const { return cmdModel; }
+    TSCCommandFilterModel *filter() const { return cmdFilter; }
+    TSCUndoHistory *history() const { return undoHistory; }
+
+    QString fileName() const { return path; }
+    // TSCListCache::hash() of the file as last loaded or saved, to tell outside changes from our own
+    quint64 diskHash() const { return savedHash; }
+    void setDiskHash(quint64 hash) { savedHash = hash; }
+    void setFileName(const QString &fileName);
+    QString displayName() const;
+
+    // edits set this on their own, through the undo history
+    bool hasUnsavedMods() const { return unsavedMods; }
+    void setUnsavedMods(bool unsaved);
+
+signals:
+    void stateChanged();
+
+private:
+    TSCCommandTable table;
+    TSCCommandModel *cmdModel;
+    TSCCommandFilterModel *cmdFilter;
+    TSCUndoHistory *undoHistory;
+    QString path;
+    quint64 savedHash;
+    bool unsavedMods;
+    bool loading;
+
+    void historyChanged();
+};
+
+#endif // TSCDOCUMENT_H
@@ -0,0 +1,231 @@
+#include "tscheaderexporter.h"
+#include "tsclistwriter.h"
+
+#include <QFileInfo>
+#include <QSet>
+#include <algorithm>
+#include "tsctrace.h"
+
+namespace {
+
+// how many times each bucket may try a new seed before the whole thing starts over with more buckets
+const quint32 MaxSeedTries = 1u << 20;
+
+struct PerfectHash {
+    QVector<quint32> seeds;
+    // slot -> index into the commands
+    QVector<int> slots;
+};
+
+bool findSeeds(const QVector<quint32> &keys, int bucketCount, PerfectHash *hash)
+{
+    const int n = keys.size();
+    QVector<QVector<int>> buckets(bucketCount);
+    for (int i = 0; i < n; i++)
+        buckets[static_cast<int>(TSCHeaderExporter::mix(keys[i]) % static_cast<quint32>(bucketCount))] += i;
+    // the fullest buckets are the hardest to place, so they go first while most slots are free
+    QVector<int> order(bucketCount);
+    for (int i = 0; i < bucketCount; i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&buckets](int a, int b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+    hash->seeds.fill(0, bucketCount);
+    hash->slots.fill(-1, n);
+    QVector<int> placed;
+    for (int bucket : qAsConst(order)) {
+        const QVector<int> &members = buckets[bucket];
+        if (members.isEmpty())
+            break;
+        bool found = false;
+        for (quint32 seed = 1; seed < MaxSeedTries && !found; seed++) {
+            placed.clear();
+            found = true;
+            for (int member : members) {
+                int slot = static_cast<int>(TSCHeaderExporter::mix(keys[member] ^ seed) % static_cast<quint32>(n));
+                if (hash->slots[slot] >= 0 || placed.contains(slot)) {
+                    found = false;
+                    break;
+                }
+                placed += slot;
+            }
+            if (found) {
+                hash->seeds[bucket] = seed;
+                for (int i = 0; i < members.size(); i++)
+                    hash->slots[placed[i]] = members[i];
+            }
+        }
+        if (!found)
+            return false;
+    }
+    return true;
+}
+
+QByteArray codeLiteral(const QString &code)
+{
+    // codes are Latin-1, so anything unusual is written as an escape
+    QByteArray literal = "\"";
+    for (QChar c : code) {
+        uchar b = static_cast<uchar>(c.toLatin1());
+        if (b >= 0x20 && b < 0x7F && b != '"' && b != '\\' && b != '?')
+            literal += static_cast<char>(b);
+        else
+            literal += QByteArray("\\x") + QByteArray::number(b, 16).rightJustified(2, '0') + "\"\"";
+    }
+    return literal + "\"";
+}
+
+QByteArray charLiteral(char c)
+{
+    if (c == '\'' || c == '\\')
+        return QByteArray("'\\") + c + "'";
+    return QByteArray("'") + c + "'";
+}
+
+QByteArray hex(quint32 value)
+{
+    return "0x" + QByteArray::number(value, 16).rightJustified(8, '0') + "u";
+}
+
+}
+
+bool TSCHeaderExporter::generate(const QVector<TSCCommand> &commands, const QString &sourceName, QByteArray *header, QString *fail)
+{
+    TSC_TRACE("TSCHeaderExporter::generate");
+    const int n = commands.size();
+    QVector<quint32> keys;
+    keys.reserve(n);
+    QSet<quint32> seen;
+    seen.reserve(n);
+    for (const TSCCommand &cmd : commands) {
+        if (seen.contains(cmd.codeKey())) {
+            *fail = QString("Code %1 is used more than once").arg(cmd.code());
+            return false;
+        }
+        seen.insert(cmd.codeKey());
+        keys += cmd.codeKey();
+    }
+
+    PerfectHash hash;
+    if (n > 0) {
+        // about 4 codes per bucket makes the seeds quick to find; every failed round halves that
+        bool found = false;
+        for (int bucketCount = qMax(1, n / 4); bucketCount <= 4 * n && !found; bucketCount *= 2)
+            found = findSeeds(keys, bucketCount, &hash);
+        if (!found) {
+            *fail = "Could not find a perfect hash for these codes";
+            return false;
+        }
+    }
+
+    // a code that's not in the list, for checking that misses miss
+    quint32 missingKey = TSCCommand::codeKey("????");
+    while (seen.contains(missingKey))
+        missingKey++;
+
+    QByteArray out;
+    QByteArray guard = "TSC_COMMANDS_H";
+    out += "// Generated by TSCListEdit from " + QFileInfo(sourceName).fileName().toUtf8() + ", do not edit.\n";
+    out += "// Look up a command with tsc::findCommand(tsc::packCode(p)), where p points at the 4 code bytes.\n";
+    out += "#ifndef " + guard + "\n#define " + guard + "\n\n";
+    out += "#include <cstddef>\n#include <cstdint>\n\n";
+    out += "namespace tsc {\n\n";
+    out += "struct Command {\n"
+           "    // big-endian, so packCode(\"<MSG\") == ('<' << 24 | 'M' << 16 | 'S' << 8 | 'G')\n"
+           "    std::uint32_t code;\n"
+           "    char codeText[5];\n"
+           "    std::uint8_t paramCount;\n"
+           "    char paramTypes[4];\n"
+           "    std::uint8_t paramLengths[4];\n"
+           "    bool endsEvent;\n"
+           "    bool clearsTextbox;\n"
+           "    bool paramsAreSeparated;\n"
+           "};\n\n";
+    out += "constexpr std::uint32_t packCode(const char *code)\n"
+           "{\n"
+           "    return static_cast<std::uint32_t>(static_cast<unsigned char>(code[0])) << 24\n"
+           "            | static_cast<std::uint32_t>(static_cast<unsigned char>(code[1])) << 16\n"
+           "            | static_cast<std::uint32_t>(static_cast<unsigned char>(code[2])) << 8\n"
+           "            | static_cast<std::uint32_t>(static_cast<unsigned char>(code[3]));\n"
+           "}\n\n";
+    out += "namespace detail {\n\n";
+    out += "constexpr std::uint32_t mix(std::uint32_t x)\n"
+           "{\n"
+           "    x ^= x >> 16;\n"
+           "    x *= 0x7feb352du;\n"
+           "    x ^= x >> 15;\n"
+           "    x *= 0x846ca68bu;\n"
+           "    x ^= x >> 16;\n"
+           "    return x;\n"
+           "}\n\n";
+    out += "constexpr std::size_t commandCount = " + QByteArray::number(n) + ";\n";
+    out += "constexpr std::size_t seedCount = " + QByteArray::number(qMax(1, hash.seeds.size())) + ";\n\n";
+    out += "constexpr std::uint32_t seeds[seedCount] = {";
+    for (int i = 0; i < qMax(1, hash.seeds.size()); i++) {
+        out += i % 8 == 0 ? "\n    " : " ";
+        out += QByteArray::number(i < hash.seeds.size() ? hash.seeds[i] : 0) + "u,";
+    }
+    out += "\n};\n\n";
+    if (n > 0) {
+        out += "constexpr Command commands[commandCount] = {\n";
+        for (int slot = 0; slot < n; slot++) {
+            const TSCCommand &cmd = commands[hash.slots[slot]];
+            int paramCount = cmd.paramCount();
+            out += "    { " + hex(cmd.codeKey()) + ", " + codeLiteral(cmd.code()) + ", " + QByteArray::number(paramCount) + ", { ";
+            for (int i = 0; i < TSCCommand::MaxParams; i++)
+                out += charLiteral(i < paramCount ? static_cast<char>(cmd.params[i].type) : '-') + (i + 1 < TSCCommand::MaxParams ? ", " : " ");
+            out += "}, { ";
+            for (int i = 0; i < TSCCommand::MaxParams; i++)
+                out += QByteArray::number(cmd.params[i].length) + (i + 1 < TSCCommand::MaxParams ? ", " : " ");
+            out += "}, ";
+            out += cmd.endsEvent() ? "true, " : "false, ";
+            out += cmd.clearsTextbox() ? "true, " : "false, ";
+            out += cmd.paramsAreSeparated() ? "true" : "false";
+            out += " },\n";
+        }
+        out += "};\n\n";
+    }
+    out += "} // namespace detail\n\n";
+    out += "// the command with this packed code, or nullptr\n";
+    out += "constexpr const Command *findCommand(std::uint32_t code)\n{\n";
+    if (n > 0)
+        out += "    const Command &cmd = detail::commands[detail::mix(code ^ detail::seeds[detail::mix(code) % detail::seedCount]) % detail::commandCount];\n"
+               "    return cmd.code == code ? &cmd : nullptr;\n";
+    else
+        out += "    return static_cast<void>(code), nullptr;\n";
+    out += "}\n\n";
+    out += "namespace detail {\n\n";
+    out += "// every command has to be found in its own slot\n";
+    out += "constexpr bool selfTest()\n{\n";
+    if (n > 0)
+        out += "    for (std::size_t i = 0; i < commandCount; i++) {\n"
+               "        if (findCommand(commands[i].code) != &commands[i] || packCode(commands[i].codeText) != commands[i].code)\n"
+               "            return false;\n"
+               "    }\n";
+    out += "    return true;\n}\n\n";
+    out += "static_assert(selfTest(), \"command table is broken, generate it again\");\n";
+    out += "static_assert(findCommand(" + hex(missingKey) + ") == nullptr, \"unknown codes have to miss\");\n\n";
+    out += "} // namespace detail\n\n";
+    out += "} // namespace tsc\n\n";
+    out += "#endif // " + guard + "\n";
+
+    // same check on this end, in case the compiler on the other end never sees the header
+    for (int slot = 0; slot < n; slot++) {
+        quint32 key = keys[hash.slots[slot]];
+        quint32 seed = hash.seeds[static_cast<int>(mix(key) % static_cast<quint32>(hash.seeds.size()))];
+        if (static_cast<int>(mix(key ^ seed) % static_cast<quint32>(n)) != slot) {
+            *fail = "Generated table failed its self-test";
+            return false;
+        }
+    }
+    *header = out;
+    return true;
+}
+
+bool TSCHeaderExporter::exportFile(const QString &fileName, const QVector<TSCCommand> &commands, const QString &sourceName, QString *fail)
+{
+    QByteArray header;
+    if (!generate(commands, sourceName, &header, fail))
+        return false;
+    return TSCListWriter::writeFile(fileName, header, fail);
+}
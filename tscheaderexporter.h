@@ -0,0 +1,34 @@
+#ifndef TSCHEADEREXPORTER_H
+#define TSCHEADEREXPORTER_H
+
+#include <QVector>
+#include "tsccommand.h"
+
+// Turns a command list into a self-contained C++14 header for engines that
+// dispatch TSC commands: a constexpr table of every command's parameters and
+// flags, placed by a minimal perfect hash of the packed 4-byte code, so a
+// lookup is two multiply-shift hashes and one compare.
+// The hash is "hash and displace": codes are spread over buckets, and each
+// bucket gets a seed that moves its codes into free slots. The header checks
+// itself with static_asserts, so a broken table won't compile.
+
+class TSCHeaderExporter
+{
+public:
+    // the hash the generated header uses (same on both ends, so it lives here)
+    static constexpr quint32 mix(quint32 x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // fails if the codes aren't unique, or (in theory) no seeds can be found
+    static bool generate(const QVector<TSCCommand> &commands, const QString &sourceName, QByteArray *header, QString *fail);
+    static bool exportFile(const QString &fileName, const QVector<TSCCommand> &commands, const QString &sourceName, QString *fail);
+};
+
+#endif // TSCHEADEREXPORTER_H
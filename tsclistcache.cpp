@@ -0,0 +1,210 @@
+#include "tsclistcache.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QHash>
+#include <cstring>
+#include "tscstringpool.h"
+#include "tsctrace.h"
+
+namespace {
+
+const char cacheMagic[8] = { 'T', 'S', 'C', 'B', 'I', 'N', '\r', '\n' };
+const quint32 cacheVersion = 1;
+const quint32 cacheByteOrder = 0x01020304;
+
+struct CacheHeader {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;
+    qint64 sourceSize;
+    qint64 sourceMTime;
+    quint64 sourceHash;
+    quint32 commandCount;
+    quint32 poolLength; // in QChars
+};
+static_assert(sizeof(CacheHeader) == 48, "CacheHeader must have a fixed layout");
+
+struct CacheRecord {
+    quint32 codeKey;
+    char paramTypes[TSCCommand::MaxParams];
+    quint8 paramLengths[TSCCommand::MaxParams];
+    quint8 flags;
+    quint8 reserved[3];
+    quint32 nameOffset;
+    quint32 nameLength;
+    quint32 descriptionOffset;
+    quint32 descriptionLength;
+};
+static_assert(sizeof(CacheRecord) == 32, "CacheRecord must have a fixed layout");
+
+bool stampSource(const QString &sourcePath, qint64 *size, qint64 *mtime)
+{
+    QFileInfo info(sourcePath);
+    if (!info.exists())
+        return false;
+    *size = info.size();
+    *mtime = info.lastModified().toMSecsSinceEpoch();
+    return true;
+}
+
+bool hashSource(const QString &sourcePath, quint64 *hash)
+{
+    QFile src(sourcePath);
+    if (!src.open(QFile::ReadOnly))
+        return false;
+    qint64 size = src.size();
+    uchar *map = size > 0 ? src.map(0, size) : nullptr;
+    if (map) {
+        *hash = TSCListCache::hash(reinterpret_cast<const char *>(map), size);
+        src.unmap(map);
+    } else {
+        QByteArray data = src.readAll();
+        *hash = TSCListCache::hash(data.constData(), data.size());
+    }
+    return true;
+}
+
+}
+
+QString TSCListCache::cachePath(const QString &sourcePath)
+{
+    return sourcePath + ".tscbin";
+}
+
+quint64 TSCListCache::hash(const char *data, qint64 size)
+{
+    // FNV-1a over 8 bytes at a time, with an extra shift so high bits feed back down
+    quint64 h = 0xcbf29ce484222325ull;
+    const quint64 prime = 0x100000001b3ull;
+    qint64 i = 0;
+    for (; i + 8 <= size; i += 8) {
+        quint64 word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * prime;
+        h ^= h >> 29;
+    }
+    for (; i < size; i++)
+        h = (h ^ static_cast<uchar>(data[i])) * prime;
+    return h ^ static_cast<quint64>(size);
+}
+
+bool TSCListCache::load(const QString &sourcePath, TSCCommandTable *commands, quint64 *contentHash)
+{
+    TSC_TRACE("TSCListCache::load");
+    qint64 sourceSize, sourceMTime;
+    if (!stampSource(sourcePath, &sourceSize, &sourceMTime))
+        return false;
+    QFile cache(cachePath(sourcePath));
+    if (!cache.open(QFile::ReadOnly))
+        return false;
+    qint64 cacheSize = cache.size();
+    if (cacheSize < static_cast<qint64>(sizeof(CacheHeader)))
+        return false;
+    const uchar *map = cache.map(0, cacheSize);
+    if (!map)
+        return false;
+    const CacheHeader *header = reinterpret_cast<const CacheHeader *>(map);
+    // cheap checks first, only hash the source if everything else matches
+    quint64 sourceHash;
+    if (std::memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) != 0
+            || header->version != cacheVersion
+            || header->byteOrder != cacheByteOrder
+            || header->sourceSize != sourceSize
+            || header->sourceMTime != sourceMTime
+            || cacheSize != static_cast<qint64>(sizeof(CacheHeader) + header->commandCount * sizeof(CacheRecord) + header->poolLength * sizeof(QChar))
+            || !hashSource(sourcePath, &sourceHash)
+            || header->sourceHash != sourceHash)
+        return false;
+    const CacheRecord *records = reinterpret_cast<const CacheRecord *>(map + sizeof(CacheHeader));
+    const QChar *pool = reinterpret_cast<const QChar *>(records + header->commandCount);
+    TSCCommandTable newCommands;
+    newCommands.reserve(static_cast<int>(header->commandCount));
+    TSCStringPool strings;
+    for (quint32 i = 0; i < header->commandCount; i++) {
+        const CacheRecord &record = records[i];
+        if (static_cast<quint64>(record.nameOffset) + record.nameLength > header->poolLength
+                || static_cast<quint64>(record.descriptionOffset) + record.descriptionLength > header->poolLength)
+            return false;
+        TSCCommand cmd;
+        cmd.setCodeKey(record.codeKey);
+        for (int j = 0; j < TSCCommand::MaxParams; j++) {
+            if (!TSCCommand::isValidParameterType(record.paramTypes[j]))
+                return false;
+            cmd.params[j].type = static_cast<TSCCommand::ParameterType>(record.paramTypes[j]);
+            cmd.params[j].length = record.paramLengths[j];
+        }
+        cmd.setPackedFlags(record.flags);
+        cmd.name = strings.intern(pool + record.nameOffset, static_cast<int>(record.nameLength));
+        cmd.setDescription(strings.intern(pool + record.descriptionOffset, static_cast<int>(record.descriptionLength)));
+        newCommands.append(cmd);
+    }
+    *commands = std::move(newCommands);
+    if (contentHash)
+        *contentHash = sourceHash;
+    return true;
+}
+
+bool TSCListCache::save(const QString &sourcePath, const QVector<TSCCommand> &commands, quint64 contentHash)
+{
+    TSC_TRACE("TSCListCache::save");
+    CacheHeader header;
+    std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = cacheVersion;
+    header.byteOrder = cacheByteOrder;
+    if (!stampSource(sourcePath, &header.sourceSize, &header.sourceMTime))
+        return false;
+    // make sure we're not stamping a newer version of the file with older commands
+    if (!hashSource(sourcePath, &header.sourceHash) || header.sourceHash != contentHash)
+        return false;
+    header.commandCount = static_cast<quint32>(commands.size());
+    // repeated text is only stored once; records can point at the same part of the pool
+    QHash<QString, quint32> offsets;
+    QVector<QPair<quint32, quint32>> spans;
+    spans.reserve(commands.size() * 2);
+    quint32 poolLength = 0;
+    for (const TSCCommand &cmd : commands) {
+        // decoded just for this, rather than through description(), which would keep the result around
+        const QString description = cmd.hasDescriptionSource() ? QString::fromUtf8(cmd.descriptionUtf8()) : cmd.description();
+        for (const QString &text : { cmd.name, description }) {
+            auto it = offsets.constFind(text);
+            if (it == offsets.constEnd()) {
+                it = offsets.insert(text, poolLength);
+                poolLength += static_cast<quint32>(text.size());
+            }
+            spans += qMakePair(it.value(), static_cast<quint32>(text.size()));
+        }
+    }
+    header.poolLength = poolLength;
+
+    QByteArray out;
+    out.resize(static_cast<int>(sizeof(CacheHeader) + commands.size() * sizeof(CacheRecord) + poolLength * sizeof(QChar)));
+    char *data = out.data();
+    std::memcpy(data, &header, sizeof(CacheHeader));
+    CacheRecord *records = reinterpret_cast<CacheRecord *>(data + sizeof(CacheHeader));
+    QChar *pool = reinterpret_cast<QChar *>(records + commands.size());
+    for (auto it = offsets.constBegin(); it != offsets.constEnd(); ++it)
+        std::memcpy(pool + it.value(), it.key().constData(), it.key().size() * sizeof(QChar));
+    for (int i = 0; i < commands.size(); i++) {
+        const TSCCommand &cmd = commands[i];
+        CacheRecord &record = records[i];
+        std::memset(&record, 0, sizeof(CacheRecord));
+        record.codeKey = cmd.codeKey();
+        for (int j = 0; j < TSCCommand::MaxParams; j++) {
+            record.paramTypes[j] = cmd.params[j].type;
+            record.paramLengths[j] = cmd.params[j].length;
+        }
+        record.flags = cmd.packedFlags();
+        record.nameOffset = spans[2 * i].first;
+        record.nameLength = spans[2 * i].second;
+        record.descriptionOffset = spans[2 * i + 1].first;
+        record.descriptionLength = spans[2 * i + 1].second;
+    }
+
+    QSaveFile dst(cachePath(sourcePath));
+    if (!dst.open(QFile::WriteOnly) || dst.write(out) != out.size())
+        return false;
+    return dst.commit();
+}
@@ -0,0 +1,28 @@
+#ifndef TSCLISTCACHE_H
+#define TSCLISTCACHE_H
+
+#include <QVector>
+#include "tsccommandtable.h"
+
+// Binary sidecar (<list>.tscbin) holding an already-parsed command list.
+// Layout: a fixed header, then one fixed-size record per command, then a
+// pool of UTF-16 text that records point into (each distinct string is only
+// stored once). Everything is read straight out of the mapped file, no
+// parsing involved.
+// The sidecar is stamped with the source's size, mtime and content hash and
+// ignored if any of them don't match; the text file is always authoritative.
+
+class TSCListCache
+{
+public:
+    static QString cachePath(const QString &sourcePath);
+    // contentHash, if given, receives hash() of the source file
+    static bool load(const QString &sourcePath, TSCCommandTable *commands, quint64 *contentHash = nullptr);
+    // contentHash is the hash of the text the commands were parsed from;
+    // nothing is written if the source has changed since
+    static bool save(const QString &sourcePath, const QVector<TSCCommand> &commands, quint64 contentHash);
+
+    static quint64 hash(const char *data, qint64 size);
+};
+
+#endif // TSCLISTCACHE_H
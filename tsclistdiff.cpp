@@ -0,0 +1,154 @@
+#include "tsclistdiff.h"
+#include "tsctrace.h"
+
+#include <algorithm>
+
+namespace {
+
+// FNV-1a
+inline quint64 hashBytes(quint64 h, const void *data, size_t size)
+{
+    const uchar *bytes = static_cast<const uchar *>(data);
+    for (size_t i = 0; i < size; i++) {
+        h ^= bytes[i];
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
+
+enum Step : quint8 {
+    Keep,
+    Delete,
+    Add,
+};
+
+}
+
+quint64 TSCListDiff::commandHash(const TSCCommand &cmd)
+{
+    quint64 h = 0xCBF29CE484222325ull;
+    quint32 key = cmd.codeKey();
+    quint8 flags = cmd.packedFlags();
+    h = hashBytes(h, &key, sizeof(key));
+    h = hashBytes(h, &flags, sizeof(flags));
+    for (const TSCCommand::Parameter &param : cmd.params) {
+        h = hashBytes(h, &param.type, sizeof(param.type));
+        h = hashBytes(h, &param.length, sizeof(param.length));
+    }
+    // the size keeps "ab" + "c" and "a" + "bc" apart
+    int nameSize = cmd.name.size();
+    h = hashBytes(h, &nameSize, sizeof(nameSize));
+    h = hashBytes(h, cmd.name.constData(), cmd.name.size() * sizeof(QChar));
+    // UTF-8, so descriptions still in the file buffer don't need decoding
+    QByteArray description = cmd.descriptionUtf8();
+    h = hashBytes(h, description.constData(), static_cast<size_t>(description.size()));
+    return h;
+}
+
+bool TSCListDiff::diff(const QVector<TSCCommand> &from, const QVector<TSCCommand> &to, QVector<Edit> *edits, int maxEdits)
+{
+    TSC_TRACE("TSCListDiff::diff");
+    edits->clear();
+    int head = 0;
+    int fromEnd = from.size(), toEnd = to.size();
+    while (head < fromEnd && head < toEnd && commandHash(from[head]) == commandHash(to[head]))
+        head++;
+    while (fromEnd > head && toEnd > head && commandHash(from[fromEnd - 1]) == commandHash(to[toEnd - 1])) {
+        fromEnd--;
+        toEnd--;
+    }
+    QVector<quint64> a(fromEnd - head), b(toEnd - head);
+    for (int i = 0; i < a.size(); i++)
+        a[i] = commandHash(from[head + i]);
+    for (int i = 0; i < b.size(); i++)
+        b[i] = commandHash(to[head + i]);
+    const int n = a.size(), m = b.size();
+    if (qAbs(n - m) > maxEdits)
+        return false;
+
+    // forward pass; trace[d] holds diagonals -d-1..d+1 of V as it was before step d
+    const int limit = qMin(n + m, maxEdits);
+    const int offset = limit + 1;
+    QVector<int> v(2 * limit + 3, 0);
+    QVector<QVector<int>> trace;
+    int found = -1;
+    for (int d = 0; d <= limit && found < 0; d++) {
+        trace += v.mid(offset - d - 1, 2 * d + 3);
+        for (int k = -d; k <= d; k += 2) {
+            int x;
+            if (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1]))
+                x = v[offset + k + 1];
+            else
+                x = v[offset + k - 1] + 1;
+            int y = x - k;
+            while (x < n && y < m && a[x] == b[y]) {
+                x++;
+                y++;
+            }
+            v[offset + k] = x;
+            if (x >= n && y >= m) {
+                found = d;
+                break;
+            }
+        }
+    }
+    if (found < 0)
+        return false;
+
+    // walk back through the trace, collecting steps end to start
+    QVector<Step> steps;
+    QVector<int> positions;
+    int x = n, y = m;
+    for (int d = found; d >= 0; d--) {
+        const QVector<int> &vd = trace[d];
+        // vd[0] is diagonal -d-1
+        auto at = [&vd, d](int k) { return vd[k + d + 1]; };
+        int k = x - y;
+        int prevK = (k == -d || (k != d && at(k - 1) < at(k + 1))) ? k + 1 : k - 1;
+        int prevX = d > 0 ? at(prevK) : 0;
+        int prevY = prevX - prevK;
+        while (x > prevX && y > prevY) {
+            steps += Keep;
+            positions += --x;
+            --y;
+        }
+        if (d > 0) {
+            if (prevK == k + 1) {
+                steps += Add;
+                positions += prevY;
+            } else {
+                steps += Delete;
+                positions += prevX;
+            }
+        }
+        x = prevX;
+        y = prevY;
+    }
+    std::reverse(steps.begin(), steps.end());
+    std::reverse(positions.begin(), positions.end());
+
+    // turn the steps into row edits; a delete next to an add becomes a replace
+    int row = head;
+    for (int i = 0; i < steps.size(); i++) {
+        switch (steps[i]) {
+        case Keep:
+            row++;
+            break;
+        case Delete:
+            if (i + 1 < steps.size() && steps[i + 1] == Add) {
+                *edits += Edit { Edit::Replace, row++, head + positions[++i] };
+                break;
+            }
+            *edits += Edit { Edit::Remove, row, -1 };
+            break;
+        case Add:
+            if (i + 1 < steps.size() && steps[i + 1] == Delete) {
+                *edits += Edit { Edit::Replace, row++, head + positions[i++] };
+                break;
+            }
+            *edits += Edit { Edit::Insert, row++, head + positions[i] };
+            break;
+        }
+    }
+    return true;
+}
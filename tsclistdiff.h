@@ -0,0 +1,34 @@
+#ifndef TSCLISTDIFF_H
+#define TSCLISTDIFF_H
+
+#include <QVector>
+#include "tsccommand.h"
+
+// Line-level diff between two versions of a command list, for applying an
+// outside change to a file as a handful of row edits instead of a reset.
+// Every command is reduced to a 64-bit hash of everything that ends up in
+// its line; after stripping the common head and tail, what's left is
+// diffed with Myers' O(ND) algorithm, so small changes stay cheap.
+
+class TSCListDiff
+{
+public:
+    struct Edit {
+        enum Kind : quint8 {
+            Insert,
+            Remove,
+            Replace,
+        };
+        Kind kind;
+        // row in the list as it is when this edit is applied (edits are applied in order)
+        int row;
+        // index of the new command in the target list (not used by Remove)
+        int source;
+    };
+
+    // false if it takes more than maxEdits edits; replacing everything is cheaper then
+    static bool diff(const QVector<TSCCommand> &from, const QVector<TSCCommand> &to, QVector<Edit> *edits, int maxEdits = 512);
+    static quint64 commandHash(const TSCCommand &cmd);
+};
+
+#endif // TSCLISTDIFF_H
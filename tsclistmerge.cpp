@@ -0,0 +1,252 @@
+#include "tsclistmerge.h"
+
+#include <QHash>
+#include "tsctrace.h"
+
+namespace {
+
+QHash<quint32, int> rowsByCode(const QVector<TSCCommand> &commands)
+{
+    QHash<quint32, int> rows;
+    rows.reserve(commands.size());
+    for (int row = 0; row < commands.size(); row++)
+        rows.insert(commands[row].codeKey(), row);
+    return rows;
+}
+
+// the hash only keeps one row per code, so a list with the same code twice can't be merged safely
+bool checkUnique(const QVector<TSCCommand> &commands, const QHash<quint32, int> &rows, const char *side, QString *fail)
+{
+    if (rows.size() == commands.size())
+        return true;
+    for (int row = 0; row < commands.size(); row++) {
+        if (rows.value(commands[row].codeKey()) != row) {
+            *fail = QString("Code %1 is used more than once in %2").arg(commands[row].code()).arg(side);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool sameParameters(const TSCCommand &a, const TSCCommand &b)
+{
+    for (int i = 0; i < TSCCommand::MaxParams; i++) {
+        if (a.params[i].type != b.params[i].type || a.params[i].length != b.params[i].length)
+            return false;
+    }
+    return true;
+}
+
+}
+
+quint8 TSCListMerge::differingFields(const TSCCommand &a, const TSCCommand &b)
+{
+    quint8 fields = 0;
+    if (a.name != b.name)
+        fields |= NameField;
+    if (!a.hasSameDescription(b))
+        fields |= DescriptionField;
+    if (!sameParameters(a, b))
+        fields |= ParametersField;
+    if (a.endsEvent() != b.endsEvent())
+        fields |= EndsEventField;
+    if (a.clearsTextbox() != b.clearsTextbox())
+        fields |= ClearsTextboxField;
+    if (a.paramsAreSeparated() != b.paramsAreSeparated())
+        fields |= ParamsAreSeparatedField;
+    return fields;
+}
+
+void TSCListMerge::copyFields(TSCCommand *to, const TSCCommand &from, quint8 fields)
+{
+    if (fields & NameField)
+        to->name = from.name;
+    if (fields & DescriptionField)
+        to->setDescription(from.description());
+    if (fields & ParametersField) {
+        for (int i = 0; i < TSCCommand::MaxParams; i++)
+            to->params[i] = from.params[i];
+    }
+    if (fields & EndsEventField)
+        to->setEndsEvent(from.endsEvent());
+    if (fields & ClearsTextboxField)
+        to->setClearsTextbox(from.clearsTextbox());
+    if (fields & ParamsAreSeparatedField)
+        to->setParamsAreSeparated(from.paramsAreSeparated());
+}
+
+QStringList TSCListMerge::fieldNames(quint8 fields)
+{
+    QStringList names;
+    if (fields & NameField)
+        names += "name";
+    if (fields & DescriptionField)
+        names += "description";
+    if (fields & ParametersField)
+        names += "parameters";
+    if (fields & EndsEventField)
+        names += "'ends event' flag";
+    if (fields & ClearsTextboxField)
+        names += "'clears textbox' flag";
+    if (fields & ParamsAreSeparatedField)
+        names += "'parameters are separated' flag";
+    return names;
+}
+
+QString TSCListMerge::describe(const TSCCommand &cmd, quint8 fields)
+{
+    QStringList values;
+    if (fields & NameField)
+        values += QString("name \"%1\"").arg(cmd.name);
+    if (fields & DescriptionField)
+        values += QString("description \"%1\"").arg(cmd.description());
+    if (fields & ParametersField) {
+        QString types, lengths;
+        for (int i = 0; i < TSCCommand::MaxParams; i++) {
+            types += QChar::fromLatin1(cmd.params[i].type);
+            lengths += QString::number(cmd.params[i].length);
+        }
+        values += QString("parameters %1/%2").arg(types).arg(lengths);
+    }
+    if (fields & EndsEventField)
+        values += QString("ends event: %1").arg(cmd.endsEvent() ? "yes" : "no");
+    if (fields & ClearsTextboxField)
+        values += QString("clears textbox: %1").arg(cmd.clearsTextbox() ? "yes" : "no");
+    if (fields & ParamsAreSeparatedField)
+        values += QString("parameters are separated: %1").arg(cmd.paramsAreSeparated() ? "yes" : "no");
+    return values.join(", ");
+}
+
+QVector<TSCListMerge::Change> TSCListMerge::compare(const QVector<TSCCommand> &from, const QVector<TSCCommand> &to)
+{
+    TSC_TRACE("TSCListMerge::compare");
+    const QHash<quint32, int> fromRows = rowsByCode(from);
+    const QHash<quint32, int> toRows = rowsByCode(to);
+    QVector<Change> changes;
+    for (int row = 0; row < to.size(); row++) {
+        quint32 key = to[row].codeKey();
+        int fromRow = fromRows.value(key, -1);
+        if (fromRow < 0) {
+            changes += { Change::Added, key, -1, row, 0 };
+            continue;
+        }
+        quint8 fields = differingFields(from[fromRow], to[row]);
+        if (fields)
+            changes += { Change::Changed, key, fromRow, row, fields };
+    }
+    for (int row = 0; row < from.size(); row++) {
+        quint32 key = from[row].codeKey();
+        if (!toRows.contains(key))
+            changes += { Change::Removed, key, row, -1, 0 };
+    }
+    return changes;
+}
+
+bool TSCListMerge::merge(const QVector<TSCCommand> &base, const QVector<TSCCommand> &ours, const QVector<TSCCommand> &theirs, Result *merged, QString *fail, Side prefer)
+{
+    TSC_TRACE("TSCListMerge::merge");
+    const QHash<quint32, int> baseRows = rowsByCode(base);
+    const QHash<quint32, int> ourRows = rowsByCode(ours);
+    const QHash<quint32, int> theirRows = rowsByCode(theirs);
+    if (!checkUnique(base, baseRows, "the common ancestor", fail) || !checkUnique(ours, ourRows, "ours", fail)
+            || !checkUnique(theirs, theirRows, "theirs", fail))
+        return false;
+    Result result;
+
+    // commands only theirs has go right after whatever comes before them in theirs
+    // (and is also in ours); after[0] is the start of the list, after[i + 1] is after ours[i]
+    QVector<QVector<int>> after(ours.size() + 1);
+    int anchor = 0;
+    for (int row = 0; row < theirs.size(); row++) {
+        quint32 key = theirs[row].codeKey();
+        int ourRow = ourRows.value(key, -1);
+        if (ourRow >= 0) {
+            anchor = ourRow + 1;
+            continue;
+        }
+        int baseRow = baseRows.value(key, -1);
+        // we removed it; that only sticks if they didn't change it since
+        if (baseRow >= 0 && differingFields(base[baseRow], theirs[row]) == 0)
+            continue;
+        after[anchor] += row;
+    }
+
+    result.commands.reserve(ours.size() + theirs.size());
+    auto addTheirs = [&](int row) {
+        const TSCCommand &cmd = theirs[row];
+        int baseRow = baseRows.value(cmd.codeKey(), -1);
+        int newRow = result.commands.size();
+        result.commands += cmd;
+        if (baseRow < 0) {
+            result.changes += { Change::Added, cmd.codeKey(), -1, newRow, 0 };
+            return;
+        }
+        // we removed it, they changed it
+        result.conflicts += { cmd.codeKey(), newRow, 0, true, false, true, base[baseRow], TSCCommand(), cmd };
+    };
+    for (int row : qAsConst(after[0]))
+        addTheirs(row);
+    for (int ourRow = 0; ourRow < ours.size(); ourRow++) {
+        const TSCCommand &our = ours[ourRow];
+        quint32 key = our.codeKey();
+        int baseRow = baseRows.value(key, -1);
+        int theirRow = theirRows.value(key, -1);
+        if (theirRow < 0) {
+            if (baseRow < 0) {
+                // we added it
+                result.commands += our;
+            } else if (differingFields(base[baseRow], our) == 0) {
+                result.changes += { Change::Removed, key, ourRow, -1, 0 };
+            } else {
+                // they removed it, we changed it
+                result.conflicts += { key, result.commands.size(), 0, true, true, false, base[baseRow], our, TSCCommand() };
+                result.commands += our;
+            }
+        } else {
+            const TSCCommand &their = theirs[theirRow];
+            // without a common version, every difference counts as changed on both sides
+            quint8 ourChanges = baseRow >= 0 ? differingFields(base[baseRow], our) : AllFields;
+            quint8 theirChanges = baseRow >= 0 ? differingFields(base[baseRow], their) : AllFields;
+            quint8 differences = differingFields(our, their);
+            quint8 taken = theirChanges & ~ourChanges & differences;
+            quint8 conflicting = ourChanges & theirChanges & differences;
+            TSCCommand merged = our;
+            copyFields(&merged, their, taken);
+            if (prefer == Theirs)
+                copyFields(&merged, their, conflicting);
+            if (taken)
+                result.changes += { Change::Changed, key, ourRow, result.commands.size(), taken };
+            if (conflicting)
+                result.conflicts += { key, result.commands.size(), conflicting, baseRow >= 0, true, true, baseRow >= 0 ? base[baseRow] : TSCCommand(), our, their };
+            result.commands += merged;
+        }
+        for (int row : qAsConst(after[ourRow + 1]))
+            addTheirs(row);
+    }
+    *merged = std::move(result);
+    return true;
+}
+
+QVector<TSCCommand> TSCListMerge::resolve(const Result &result, const QVector<Side> &choices)
+{
+    QVector<TSCCommand> commands = result.commands;
+    QVector<bool> dropped(commands.size(), false);
+    for (int i = 0; i < result.conflicts.size(); i++) {
+        const Conflict &conflict = result.conflicts[i];
+        bool ours = choices.value(i, Ours) == Ours;
+        const TSCCommand &chosen = ours ? conflict.ours : conflict.theirs;
+        if (conflict.fields != 0)
+            copyFields(&commands[conflict.row], chosen, conflict.fields);
+        else if (ours ? conflict.inOurs : conflict.inTheirs)
+            commands[conflict.row] = chosen;
+        else
+            dropped[conflict.row] = true;
+    }
+    int to = 0;
+    for (int row = 0; row < commands.size(); row++) {
+        if (!dropped[row])
+            commands[to++] = std::move(commands[row]);
+    }
+    commands.resize(to);
+    return commands;
+}
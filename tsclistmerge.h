@@ -0,0 +1,87 @@
+#ifndef TSCLISTMERGE_H
+#define TSCLISTMERGE_H
+
+#include <QVector>
+#include <QStringList>
+#include "tsccommand.h"
+
+// Compares and merges command lists by code rather than by line, so a merge
+// can never produce a duplicate code or a wrong header count (lists that
+// already have one aren't merged at all).
+// Every list gets a hash from code to row, and then each command is compared
+// field by field with its counterparts, so everything is linear in the size
+// of the lists. Commands both sides changed are merged field by field; only
+// fields both sides changed differently are conflicts.
+
+class TSCListMerge
+{
+public:
+    enum Field : quint8 {
+        NameField = 0x01,
+        DescriptionField = 0x02,
+        ParametersField = 0x04,
+        EndsEventField = 0x08,
+        ClearsTextboxField = 0x10,
+        ParamsAreSeparatedField = 0x20,
+        AllFields = 0x3F,
+    };
+
+    enum Side : quint8 {
+        Ours,
+        Theirs,
+    };
+
+    struct Change {
+        enum Kind : quint8 {
+            Added,
+            Removed,
+            Changed,
+        };
+        Kind kind;
+        quint32 codeKey;
+        // -1 if the command isn't in that list
+        int fromRow;
+        int toRow;
+        // Changed only
+        quint8 fields;
+    };
+
+    struct Conflict {
+        quint32 codeKey;
+        // in Result::commands
+        int row;
+        // fields both sides changed differently; 0 if one side removed the command and the other changed it
+        quint8 fields;
+        bool inBase;
+        bool inOurs;
+        bool inTheirs;
+        TSCCommand base;
+        TSCCommand ours;
+        TSCCommand theirs;
+    };
+
+    struct Result {
+        // conflicting fields are taken from the preferred side; a command
+        // one side removed and the other changed is always kept
+        QVector<TSCCommand> commands;
+        // what was taken from theirs, relative to ours
+        QVector<Change> changes;
+        QVector<Conflict> conflicts;
+    };
+
+    static quint8 differingFields(const TSCCommand &a, const TSCCommand &b);
+    static void copyFields(TSCCommand *to, const TSCCommand &from, quint8 fields);
+    static QStringList fieldNames(quint8 fields);
+    // the values of the given fields, for showing a conflict
+    static QString describe(const TSCCommand &cmd, quint8 fields);
+
+    // Added/Removed/Changed between two lists, in the order of the rows of to (removals last)
+    static QVector<Change> compare(const QVector<TSCCommand> &from, const QVector<TSCCommand> &to);
+    // fails if any of the lists uses a code more than once
+    static bool merge(const QVector<TSCCommand> &base, const QVector<TSCCommand> &ours, const QVector<TSCCommand> &theirs, Result *merged, QString *fail, Side prefer = Ours);
+    // the merged list with each conflict settled in favor of the given side
+    static QVector<TSCCommand> resolve(const Result &result, const QVector<Side> &choices);
+};
+Q_DECLARE_TYPEINFO(TSCListMerge::Change, Q_PRIMITIVE_TYPE);
+
+#endif // TSCLISTMERGE_H
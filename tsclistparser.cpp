@@ -0,0 +1,380 @@
+#include "tsclistparser.h"
+#include "tsclistcache.h"
+#include "tscstringpool.h"
+#include "tsctextbuffer.h"
+#include "tsctrace.h"
+
+#include <cstring>
+#include <string_view>
+
+namespace {
+
+enum CommandPart {
+    PartCode,
+    PartParamCount,
+    PartParamTypes,
+    PartName,
+    PartDescription,
+    PartEndsEvent,
+    PartClearsTextbox,
+    PartParamsAreSeparated,
+    PartParamLength1,
+    PartMax = PartParamLength1 + 4
+};
+
+constexpr const char *partNames[PartMax] = {
+    "Code",
+    "Parameter count",
+    "Parameter types",
+    "Name",
+    "Description",
+    "'Ends event' flag",
+    "'Clears textbox' flag",
+    "'Parameters are separated' flag",
+    "Parameter 1 length",
+    "Parameter 2 length",
+    "Parameter 3 length",
+    "Parameter 4 length",
+};
+
+// the field schemas of the two header formats
+struct CEFormat {
+    static constexpr bool Extended = false;
+    static constexpr int PartCount = PartDescription + 1;
+};
+
+struct BLFormat {
+    static constexpr bool Extended = true;
+    static constexpr int PartCount = PartMax;
+};
+
+// same set of characters QString::toUInt() skips around a number
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// same rules as QString::toUInt(): surrounding whitespace and a leading '+' are allowed
+uint toUInt(std::string_view s, bool *ok)
+{
+    // nearly every number in a list is a single digit
+    if (s.size() == 1 && s[0] >= '0' && s[0] <= '9') {
+        *ok = true;
+        return static_cast<uint>(s[0] - '0');
+    }
+    size_t b = 0, e = s.size();
+    while (b < e && isSpace(s[b]))
+        b++;
+    while (e > b && isSpace(s[e - 1]))
+        e--;
+    if (b < e && s[b] == '+')
+        b++;
+    *ok = false;
+    if (b == e)
+        return 0;
+    quint64 value = 0;
+    for (; b < e; b++) {
+        char c = s[b];
+        if (c < '0' || c > '9')
+            return 0;
+        value = value * 10 + static_cast<uint>(c - '0');
+        if (value > 0xFFFFFFFFu)
+            return 0;
+    }
+    *ok = true;
+    return static_cast<uint>(value);
+}
+
+inline QString toQString(std::string_view s)
+{
+    return QString::fromUtf8(s.data(), static_cast<int>(s.size()));
+}
+
+// splits lines the same way QTextStream::readLine() does ("\n" or "\r\n")
+class LineReader
+{
+public:
+    LineReader(const char *data, size_t size) : data(data), size(size), pos(0)
+    {
+        // QTextStream silently eats the UTF-8 BOM, too
+        if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+            pos = 3;
+    }
+
+    bool atEnd() const
+    {
+        return pos >= size;
+    }
+
+    size_t position() const
+    {
+        return pos;
+    }
+
+    std::string_view next()
+    {
+        const char *start = data + pos;
+        const char *nl = static_cast<const char *>(std::memchr(start, '\n', size - pos));
+        size_t len = nl ? static_cast<size_t>(nl - start) : size - pos;
+        pos += nl ? len + 1 : len;
+        if (len > 0 && start[len - 1] == '\r')
+            len--;
+        return std::string_view(start, len);
+    }
+
+private:
+    const char *data;
+    size_t size;
+    size_t pos;
+};
+
+// equivalent to QRegExp("\\[(CE|BL)_TSC\\]\\s+(\\d+)").exactMatch(line)
+bool matchHeader(std::string_view line, bool *extendedFormat, std::string_view *count)
+{
+    if (line.size() < 10 || line[0] != '[')
+        return false;
+    std::string_view format = line.substr(1, 2);
+    if ((format != "CE" && format != "BL") || line.substr(3, 5) != "_TSC]")
+        return false;
+    size_t i = 8;
+    while (i < line.size() && isSpace(line[i]))
+        i++;
+    if (i == 8)
+        return false;
+    size_t countStart = i;
+    while (i < line.size() && line[i] >= '0' && line[i] <= '9')
+        i++;
+    if (i == countStart || i != line.size())
+        return false;
+    *extendedFormat = format == "BL";
+    *count = line.substr(countStart);
+    return true;
+}
+
+// returns the total number of fields; only the first maxParts are stored
+int splitFields(std::string_view line, std::string_view *parts, int maxParts)
+{
+    int n = 0;
+    size_t start = 0;
+    while (true) {
+        size_t tab = line.find('\t', start);
+        if (n < maxParts)
+            parts[n] = line.substr(start, tab == std::string_view::npos ? std::string_view::npos : tab - start);
+        n++;
+        if (tab == std::string_view::npos)
+            return n;
+        start = tab + 1;
+    }
+}
+
+bool findHeader(LineReader &lines, bool *extendedFormat, uint *cmdCount, QString *fail)
+{
+    TSC_TRACE("TSCListParser::findHeader");
+    while (!lines.atEnd()) {
+        std::string_view countStr;
+        if (matchHeader(lines.next(), extendedFormat, &countStr)) {
+            bool ok;
+            *cmdCount = toUInt(countStr, &ok);
+            if (!ok) {
+                *fail = QString("Couldn't read command count (\"%1\") in header").arg(toQString(countStr));
+                return false;
+            }
+            return true;
+        }
+    }
+    *fail = "Could not find [CE_TSC]/[BL_TSC] header";
+    return false;
+}
+
+// the code as a key, without building a QString; only plain ASCII codes take this path
+inline bool asciiCodeKey(std::string_view code, quint32 *key)
+{
+    if (code.size() != TSCCommand::CodeLength)
+        return false;
+    quint32 k = 0;
+    for (char c : code) {
+        if (static_cast<uchar>(c) >= 0x80)
+            return false;
+        k = (k << 8) | static_cast<uchar>(c);
+    }
+    *key = k;
+    return true;
+}
+
+// parses one command line; instantiated once per format, so there's no format check per field
+template <typename Format>
+bool parseCommand(std::string_view line, uint row, const TSCCommandTable &previous, TSCStringPool &pool, const QExplicitlySharedDataPointer<TSCTextBuffer> &text, TSCCommand *newCmd, QString *fail)
+{
+    std::string_view parts[PartMax];
+    int gotParts = splitFields(line, parts, Format::PartCount);
+    if (gotParts < Format::PartCount) {
+        QStringList missing;
+        for (int part = gotParts; part < Format::PartCount; part++)
+            missing += partNames[part];
+        *fail = QString("Command %1 has missing parts: %2").arg(toQString(parts[PartCode])).arg(missing.join(", "));
+        return false;
+    }
+    quint32 codeKey;
+    if (asciiCodeKey(parts[PartCode], &codeKey)) {
+        newCmd->setCodeKey(codeKey);
+    } else {
+        QString code = toQString(parts[PartCode]);
+        if (!TSCCommand::isValidCode(code)) {
+            *fail = QString("Command %1 has invalid code (must be %2 Latin-1 characters)").arg(code).arg(TSCCommand::CodeLength);
+            return false;
+        }
+        newCmd->setCode(code);
+    }
+    // only needed for error messages from here on
+    auto code = [newCmd]() { return newCmd->code(); };
+    int conflict = previous.indexOf(newCmd->codeKey());
+    if (conflict >= 0) {
+        *fail = QString("Commands #%1 and #%2 have same code %3").arg(conflict + 1).arg(row + 1).arg(code());
+        return false;
+    }
+    bool ok;
+    uint paramCount = toUInt(parts[PartParamCount], &ok);
+    if (!ok) {
+        *fail = QString("Command %1 has unparsable number %2 in part %3").arg(code()).arg(toQString(parts[PartParamCount])).arg(partNames[PartParamCount]);
+        return false;
+    }
+    if (paramCount > 4) {
+        *fail = QString("Command %1 has too many parameters (%2 > 4)").arg(code()).arg(paramCount);
+        return false;
+    }
+    std::string_view paramTypes = parts[PartParamTypes];
+    for (uint j = 0; j < paramCount; j++) {
+        char type = j < paramTypes.size() ? paramTypes[j] : '\0';
+        if (!TSCCommand::isValidParameterType(type)) {
+            // QString::toLatin1() turns anything outside Latin-1 into '?'
+            if (static_cast<uchar>(type) >= 0x80)
+                type = '?';
+            *fail = QString("Command %1 has unknown parameter type '%2' for parameter #%3").arg(code()).arg(type).arg(j + 1);
+            return false;
+        }
+        newCmd->params[j].type = static_cast<TSCCommand::ParameterType>(type);
+    }
+    newCmd->name = pool.intern(parts[PartName]);
+    std::string_view description = parts[PartDescription];
+    int span = -1;
+    if (text && !description.empty())
+        span = text->addSpan(static_cast<int>(description.data() - text->bytes().constData()), static_cast<int>(description.size()));
+    if (span >= 0)
+        newCmd->setDescriptionSource(text, span);
+    else
+        newCmd->setDescription(pool.intern(description));
+    if constexpr (Format::Extended) {
+        bool flags[3];
+        for (int part = PartEndsEvent; part <= PartParamsAreSeparated; part++) {
+            flags[part - PartEndsEvent] = toUInt(parts[part], &ok) > 0;
+            if (!ok) {
+                *fail = QString("Command %1 has unparsable number %2 in part %3").arg(code()).arg(toQString(parts[part])).arg(partNames[part]);
+                return false;
+            }
+        }
+        newCmd->setEndsEvent(flags[0]);
+        newCmd->setClearsTextbox(flags[1]);
+        newCmd->setParamsAreSeparated(flags[2]);
+        for (uint j = 0; j < paramCount; j++) {
+            int part = PartParamLength1 + static_cast<int>(j);
+            uint length = toUInt(parts[part], &ok);
+            if (!ok) {
+                *fail = QString("Command %1 has unparsable number %2 in part %3").arg(code()).arg(toQString(parts[part])).arg(partNames[part]);
+                return false;
+            }
+            if (length == 0 || length > 4) {
+                *fail = QString("Command %1 has bad parameter length for parameter #%2 (%3 == 0 or %3 > 4)").arg(code()).arg(j + 1).arg(length);
+                return false;
+            }
+            newCmd->params[j].length = static_cast<quint8>(length);
+        }
+    }
+    return true;
+}
+
+template <typename Format>
+bool parseCommands(LineReader &lines, uint cmdCount, qint64 size, const QByteArray *owner, TSCCommandTable *commands, QString *fail, const TSCListParser::BatchHandler &onBatch)
+{
+    TSC_TRACE("TSCListParser::parseCommands");
+    // every command line takes at least PartCount bytes, so don't trust the header blindly
+    const int maxCommands = static_cast<int>(qMin<qint64>(cmdCount, size / Format::PartCount + 1));
+    TSCCommandTable newCommands;
+    newCommands.reserve(maxCommands);
+    TSCStringPool pool;
+    QExplicitlySharedDataPointer<TSCTextBuffer> text;
+    if (owner)
+        text = new TSCTextBuffer(*owner, maxCommands);
+    int batchStart = 0;
+    int batchSize = 256;
+    for (uint i = 0; i < cmdCount; i++) {
+        if (onBatch && newCommands.size() - batchStart >= batchSize) {
+            if (!onBatch(newCommands.commands().mid(batchStart), static_cast<qint64>(lines.position()), size)) {
+                *fail = "Loading was cancelled";
+                return false;
+            }
+            batchStart = newCommands.size();
+            batchSize = qMin(batchSize * 2, 16384);
+        }
+        if (lines.atEnd()) {
+            *fail = QString("Incorrect command count; claims there are %1 commands, but only has %2").arg(cmdCount).arg(i);
+            return false;
+        }
+        TSCCommand newCmd;
+        if (!parseCommand<Format>(lines.next(), i, newCommands, pool, text, &newCmd, fail))
+            return false;
+        newCommands.append(newCmd);
+    }
+    if (onBatch && !onBatch(newCommands.commands().mid(batchStart), size, size)) {
+        *fail = "Loading was cancelled";
+        return false;
+    }
+    // done!
+    *commands = std::move(newCommands);
+    return true;
+}
+
+}
+
+bool TSCListParser::parseFile(QFile *src, TSCCommandTable *commands, QString *fail, quint64 *contentHash, const BatchHandler &onBatch)
+{
+    TSC_TRACE("TSCListParser::parseFile");
+    if (!src->open(QFile::ReadOnly)) {
+        *fail = "Could not open file for reading";
+        return false;
+    }
+    // read in rather than mapped, since the commands keep referring to it for their descriptions
+    QByteArray data = src->readAll();
+    src->close();
+    bool ok = parse(data, commands, fail, onBatch);
+    if (ok && contentHash)
+        *contentHash = TSCListCache::hash(data.constData(), data.size());
+    return ok;
+}
+
+bool TSCListParser::parseHeader(const char *data, qint64 size, bool *extendedFormat, uint *cmdCount, QString *fail)
+{
+    LineReader lines(data, static_cast<size_t>(size));
+    return findHeader(lines, extendedFormat, cmdCount, fail);
+}
+
+bool TSCListParser::parse(const char *data, qint64 size, TSCCommandTable *commands, QString *fail, const BatchHandler &onBatch)
+{
+    return parseBuffer(data, size, nullptr, commands, fail, onBatch);
+}
+
+bool TSCListParser::parse(const QByteArray &data, TSCCommandTable *commands, QString *fail, const BatchHandler &onBatch)
+{
+    return parseBuffer(data.constData(), data.size(), &data, commands, fail, onBatch);
+}
+
+bool TSCListParser::parseBuffer(const char *data, qint64 size, const QByteArray *owner, TSCCommandTable *commands, QString *fail, const BatchHandler &onBatch)
+{
+    LineReader lines(data, static_cast<size_t>(size));
+    bool extendedFormat;
+    uint cmdCount;
+    if (!findHeader(lines, &extendedFormat, &cmdCount, fail))
+        return false;
+    if (extendedFormat)
+        return parseCommands<BLFormat>(lines, cmdCount, size, owner, commands, fail, onBatch);
+    return parseCommands<CEFormat>(lines, cmdCount, size, owner, commands, fail, onBatch);
+}
@@ -0,0 +1,34 @@
+#ifndef TSCLISTPARSER_H
+#define TSCLISTPARSER_H
+
+#include <QFile>
+#include <functional>
+#include "tsccommandtable.h"
+
+// Parses tsc_list.txt files directly over the file bytes.
+// Lines and fields are tokenized as views into the buffer, so owned strings
+// are only built for the fields a TSCCommand actually keeps. When parsing a
+// QByteArray, descriptions aren't even decoded; commands just refer back
+// into the (shared) buffer, see TSCCommand::setDescriptionSource().
+
+class TSCListParser
+{
+public:
+    // gets each batch of newly parsed commands while parsing (starting small,
+    // so the first rows show up right away); returning false cancels parsing
+    typedef std::function<bool(const QVector<TSCCommand> &batch, qint64 bytesDone, qint64 bytesTotal)> BatchHandler;
+
+    // contentHash, if given, receives TSCListCache::hash() of the parsed bytes
+    static bool parseFile(QFile *src, TSCCommandTable *commands, QString *fail, quint64 *contentHash = nullptr, const BatchHandler &onBatch = BatchHandler());
+    // decodes everything up front, since nothing keeps data alive afterwards
+    static bool parse(const char *data, qint64 size, TSCCommandTable *commands, QString *fail, const BatchHandler &onBatch = BatchHandler());
+    static bool parse(const QByteArray &data, TSCCommandTable *commands, QString *fail, const BatchHandler &onBatch = BatchHandler());
+    // just finds the header; extendedFormat is true for [BL_TSC], false for [CE_TSC]
+    static bool parseHeader(const char *data, qint64 size, bool *extendedFormat, uint *cmdCount, QString *fail);
+
+private:
+    // owner is the buffer data points into, if any
+    static bool parseBuffer(const char *data, qint64 size, const QByteArray *owner, TSCCommandTable *commands, QString *fail, const BatchHandler &onBatch);
+};
+
+#endif // TSCLISTPARSER_H
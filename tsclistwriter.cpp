@@ -0,0 +1,78 @@
+#include "tsclistwriter.h"
+
+#include <QSaveFile>
+#include "tsclistcache.h"
+#include "tsctrace.h"
+
+QByteArray TSCListWriter::serialize(const QVector<TSCCommand> &commands)
+{
+    TSC_TRACE("TSCListWriter::serialize");
+    // fixed part of a line: code, 3 single digit fields, 4 types, 4 lengths and 11 tabs
+    const int fixedLineSize = TSCCommand::CodeLength + 3 + 4 + 4 + 11 + 1;
+    int estimate = 32;
+    for (const TSCCommand &cmd : commands)
+        estimate += fixedLineSize + cmd.name.size() + cmd.descriptionSizeHint();
+    QByteArray out;
+    out.reserve(estimate);
+    // write header
+    out += "[BL_TSC]\t";
+    out += QByteArray::number(commands.size());
+    out += '\n';
+    // write commands
+    for (const TSCCommand &cmd : commands) {
+        out += cmd.code().toUtf8();
+        out += '\t';
+        int paramCount = cmd.paramCount();
+        out += static_cast<char>('0' + paramCount);
+        out += '\t';
+        for (int i = 0; i < TSCCommand::MaxParams; i++)
+            out += i < paramCount ? static_cast<char>(cmd.params[i].type) : '-';
+        out += '\t';
+        out += cmd.name.toUtf8();
+        out += '\t';
+        out += cmd.descriptionUtf8();
+        out += '\t';
+        out += cmd.endsEvent() ? '1' : '0';
+        out += '\t';
+        out += cmd.clearsTextbox() ? '1' : '0';
+        out += '\t';
+        out += cmd.paramsAreSeparated() ? '1' : '0';
+        for (int i = 0; i < TSCCommand::MaxParams; i++) {
+            out += '\t';
+            out += QByteArray::number(cmd.params[i].length);
+        }
+        out += '\n';
+    }
+    return out;
+}
+
+bool TSCListWriter::writeFile(const QString &fileName, const QByteArray &data, QString *fail)
+{
+    TSC_TRACE("TSCListWriter::writeFile");
+    QSaveFile dst(fileName);
+    if (!dst.open(QFile::WriteOnly)) {
+        *fail = "Could not open file for writing";
+        return false;
+    }
+    if (dst.write(data) != data.size()) {
+        *fail = QString("Could not write file: %1").arg(dst.errorString());
+        dst.cancelWriting();
+        return false;
+    }
+    if (!dst.commit()) {
+        *fail = QString("Could not write file: %1").arg(dst.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool TSCListWriter::saveFile(const QString &fileName, const QVector<TSCCommand> &commands, QString *fail, quint64 *contentHash)
+{
+    QByteArray data = serialize(commands);
+    if (!writeFile(fileName, data, fail))
+        return false;
+    if (contentHash)
+        *contentHash = TSCListCache::hash(data.constData(), data.size());
+    *fail = QString("Successfully saved %1 commands to \"%2\"").arg(commands.size()).arg(fileName);
+    return true;
+}
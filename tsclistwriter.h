@@ -0,0 +1,21 @@
+#ifndef TSCLISTWRITER_H
+#define TSCLISTWRITER_H
+
+#include <QVector>
+#include "tsccommand.h"
+
+// Writes tsc_list.txt files (always in the [BL_TSC] format).
+// Commands are serialized into a single buffer up front, and the file is
+// replaced atomically through QSaveFile, so a crash mid-save leaves the
+// original file intact. Safe to call from worker threads.
+
+class TSCListWriter
+{
+public:
+    static QByteArray serialize(const QVector<TSCCommand> &commands);
+    static bool writeFile(const QString &fileName, const QByteArray &data, QString *fail);
+    // contentHash, if given, receives TSCListCache::hash() of what was written
+    static bool saveFile(const QString &fileName, const QVector<TSCCommand> &commands, QString *fail, quint64 *contentHash = nullptr);
+};
+
+#endif // TSCLISTWRITER_H
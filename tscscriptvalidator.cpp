@@ -0,0 +1,132 @@
+#include "tscscriptvalidator.h"
+#include "tsccodec.h"
+
+#include <QDirIterator>
+#include <cstring>
+#include "tsctrace.h"
+
+TSCScriptValidator::TSCScriptValidator(const QVector<TSCCommand> &commands)
+{
+    // keep the table at most half full; key 0 marks an empty slot
+    int bits = 4;
+    while ((1 << bits) < commands.size() * 2)
+        bits++;
+    shift = 32 - bits;
+    entries.fill(Entry(), 1 << bits);
+    for (const TSCCommand &cmd : commands) {
+        quint32 key = cmd.codeKey();
+        if (key == 0)
+            continue;
+        quint32 mask = static_cast<quint32>(entries.size() - 1);
+        quint32 slot = (key * 2654435761u) >> shift;
+        while (entries[static_cast<int>(slot)].key != 0 && entries[static_cast<int>(slot)].key != key)
+            slot = (slot + 1) & mask;
+        Entry &entry = entries[static_cast<int>(slot)];
+        // on duplicate codes, the first one wins
+        if (entry.key == key)
+            continue;
+        entry.key = key;
+        entry.paramCount = static_cast<quint8>(cmd.paramCount());
+        for (int i = 0; i < TSCCommand::MaxParams; i++)
+            entry.paramLengths[i] = cmd.params[i].length;
+        entry.paramsAreSeparated = cmd.paramsAreSeparated();
+    }
+}
+
+const TSCScriptValidator::Entry *TSCScriptValidator::find(quint32 key) const
+{
+    quint32 mask = static_cast<quint32>(entries.size() - 1);
+    quint32 slot = (key * 2654435761u) >> shift;
+    const Entry *table = entries.constData();
+    while (table[slot].key != 0) {
+        if (table[slot].key == key)
+            return &table[slot];
+        slot = (slot + 1) & mask;
+    }
+    return nullptr;
+}
+
+QStringList TSCScriptValidator::findScripts(const QString &directory)
+{
+    QStringList scripts;
+    QDirIterator it(directory, QStringList() << "*.tsc", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+        scripts += it.next();
+    scripts.sort();
+    return scripts;
+}
+
+QVector<TSCScriptIssue> TSCScriptValidator::validateFile(const QString &fileName) const
+{
+    TSC_TRACE("TSCScriptValidator::validateFile");
+    QByteArray data;
+    QString fail;
+    if (!TSCCodec::decodeFile(fileName, &data, &fail))
+        return { TSCScriptIssue { fileName, 0, 0, fail } };
+    return validate(fileName, data.constData(), data.size());
+}
+
+QVector<TSCScriptIssue> TSCScriptValidator::validate(const QString &fileName, const char *data, qint64 size) const
+{
+    QVector<TSCScriptIssue> issues;
+    const char *end = data + size;
+    const char *scan = data;
+    // line counting trails behind the scan, so it's only ever done once per byte
+    const char *counted = data;
+    const char *lineStart = data;
+    int line = 1;
+    const char *lt;
+    while (scan < end && (lt = static_cast<const char *>(std::memchr(scan, '<', static_cast<size_t>(end - scan))))) {
+        for (const char *nl = counted; (nl = static_cast<const char *>(std::memchr(nl, '\n', static_cast<size_t>(lt - nl)))); nl++) {
+            line++;
+            lineStart = nl + 1;
+        }
+        counted = lt;
+        auto report = [&](const QString &message) {
+            issues += TSCScriptIssue { fileName, line, static_cast<int>(lt - lineStart) + 1, message };
+        };
+        if (end - lt < TSCCommand::CodeLength) {
+            report(QString("Truncated command %1").arg(QString::fromLatin1(lt, static_cast<int>(end - lt))));
+            break;
+        }
+        QString code = QString::fromLatin1(lt, TSCCommand::CodeLength);
+        quint32 key = (static_cast<quint32>(static_cast<uchar>(lt[0])) << 24) | (static_cast<quint32>(static_cast<uchar>(lt[1])) << 16)
+                | (static_cast<quint32>(static_cast<uchar>(lt[2])) << 8) | static_cast<quint32>(static_cast<uchar>(lt[3]));
+        const Entry *entry = find(key);
+        if (!entry) {
+            report(QString("Unknown command %1").arg(code));
+            scan = lt + 1;
+            continue;
+        }
+        const char *p = lt + TSCCommand::CodeLength;
+        for (int i = 0; i < entry->paramCount; i++) {
+            int length = entry->paramLengths[i];
+            const char *paramEnd = p + length;
+            const char *nextCmd = static_cast<const char *>(std::memchr(p, '<', static_cast<size_t>(qMin(paramEnd, end) - p)));
+            if (paramEnd > end || nextCmd) {
+                report(QString("Command %1 is missing parameter #%2").arg(code).arg(i + 1));
+                p = nextCmd ? nextCmd : end;
+                break;
+            }
+            for (const char *c = p; c < paramEnd; c++) {
+                if (*c < '0' || *c > '9') {
+                    report(QString("Command %1 has non-numeric parameter #%2 (\"%3\")").arg(code).arg(i + 1).arg(QString::fromLatin1(p, length)));
+                    break;
+                }
+            }
+            p = paramEnd;
+            if (entry->paramsAreSeparated && i + 1 < entry->paramCount) {
+                // the next command starts right here, so leave it for the scan
+                if (p >= end || *p == '<') {
+                    report(QString("Command %1 is missing parameter #%2").arg(code).arg(i + 2));
+                    break;
+                }
+                if (*p >= '0' && *p <= '9')
+                    report(QString("Command %1 has no separator after parameter #%2").arg(code).arg(i + 1));
+                p++;
+            }
+        }
+        scan = qMax(p, lt + 1);
+    }
+    return issues;
+}
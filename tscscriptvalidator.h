@@ -0,0 +1,52 @@
+#ifndef TSCSCRIPTVALIDATOR_H
+#define TSCSCRIPTVALIDATOR_H
+
+#include <QVector>
+#include "tsccommand.h"
+
+struct TSCScriptIssue {
+    QString fileName;
+    int line;
+    int column;
+    QString message;
+};
+
+// Checks every <XXXX command in (Cave Story obfuscated) .tsc scripts against
+// a command list: that the code exists, and that the parameters have the
+// right count, lengths and separators.
+// Takes a snapshot of the commands in a flat open-addressing table keyed by
+// the packed code, so lookups never touch strings. Copies are cheap and
+// const methods are safe to use from several threads at once.
+
+class TSCScriptValidator
+{
+public:
+    explicit TSCScriptValidator(const QVector<TSCCommand> &commands);
+
+    static QStringList findScripts(const QString &directory);
+
+    QVector<TSCScriptIssue> validateFile(const QString &fileName) const;
+    QVector<TSCScriptIssue> validate(const QString &fileName, const char *data, qint64 size) const;
+
+    // for QtConcurrent::mapped()
+    struct FileValidator {
+        typedef QVector<TSCScriptIssue> result_type;
+        TSCScriptValidator validator;
+        QVector<TSCScriptIssue> operator()(const QString &fileName) const { return validator.validateFile(fileName); }
+    };
+
+private:
+    struct Entry {
+        quint32 key;
+        quint8 paramCount;
+        quint8 paramLengths[TSCCommand::MaxParams];
+        bool paramsAreSeparated;
+    };
+
+    QVector<Entry> entries;
+    int shift;
+
+    const Entry *find(quint32 key) const;
+};
+
+#endif // TSCSCRIPTVALIDATOR_H
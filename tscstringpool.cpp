@@ -0,0 +1,70 @@
+#include "tscstringpool.h"
+#include "tsclistcache.h"
+
+#include <cstring>
+
+TSCStringPool::TSCStringPool() : buckets(256, -1), hitCount(0)
+{
+}
+
+QString TSCStringPool::intern(std::string_view utf8)
+{
+    if (utf8.empty())
+        return QString();
+    int size = static_cast<int>(utf8.size());
+    // the low bit tells the two kinds of keys apart, so UTF-8 and UTF-16 bytes never match each other
+    quint64 hash = TSCListCache::hash(utf8.data(), size) & ~quint64(1);
+    return lookup(utf8.data(), size, hash, [&]() {
+        return QString::fromUtf8(utf8.data(), size);
+    });
+}
+
+QString TSCStringPool::intern(const QChar *unicode, int size)
+{
+    if (size == 0)
+        return QString();
+    const char *key = reinterpret_cast<const char *>(unicode);
+    int keySize = size * static_cast<int>(sizeof(QChar));
+    quint64 hash = TSCListCache::hash(key, keySize) | 1;
+    return lookup(key, keySize, hash, [&]() {
+        return QString(unicode, size);
+    });
+}
+
+template <typename Make>
+QString TSCStringPool::lookup(const char *key, int size, quint64 hash, Make make)
+{
+    int mask = buckets.size() - 1;
+    // the low bit is the same for every key of a kind, so buckets come from the high bits
+    int slot = static_cast<int>(hash >> 32) & mask;
+    while (buckets[slot] >= 0) {
+        const Entry &entry = entries[buckets[slot]];
+        if (entry.hash == hash && entry.size == size && std::memcmp(entry.key, key, static_cast<size_t>(size)) == 0) {
+            hitCount++;
+            return entry.string;
+        }
+        slot = (slot + 1) & mask;
+    }
+    buckets[slot] = entries.size();
+    entries += Entry { hash, key, size, make() };
+    // the low bit marks UTF-16 keys, which are only borrowed for the call; the new string has the same bytes
+    Entry &added = entries.last();
+    if (hash & 1)
+        added.key = reinterpret_cast<const char *>(added.string.constData());
+    // keep the table at most half full
+    if (entries.size() * 2 > buckets.size())
+        grow();
+    return entries.last().string;
+}
+
+void TSCStringPool::grow()
+{
+    buckets.fill(-1, buckets.size() * 2);
+    int mask = buckets.size() - 1;
+    for (int i = 0; i < entries.size(); i++) {
+        int slot = static_cast<int>(entries[i].hash >> 32) & mask;
+        while (buckets[slot] >= 0)
+            slot = (slot + 1) & mask;
+        buckets[slot] = i;
+    }
+}
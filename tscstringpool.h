@@ -0,0 +1,47 @@
+#ifndef TSCSTRINGPOOL_H
+#define TSCSTRINGPOOL_H
+
+#include <QString>
+#include <QVector>
+#include <string_view>
+
+// Interns the text of commands while a list is read in: every distinct
+// name/description gets built once, and repeats get a shared copy of it
+// (QString is implicitly shared, so that's just a reference count bump).
+// Nothing is copied to remember a key: UTF-16 keys are compared against
+// the string that was built from them, and UTF-8 keys against the bytes
+// they were read from, so those have to outlive the pool (they do, the
+// pool only lives as long as one parse of the buffer).
+
+class TSCStringPool
+{
+public:
+    TSCStringPool();
+
+    QString intern(std::string_view utf8);
+    QString intern(const QChar *unicode, int size);
+
+    // distinct strings so far, and how many lookups were served by one of them
+    int count() const { return entries.size(); }
+    int hits() const { return hitCount; }
+
+private:
+    struct Entry {
+        quint64 hash;
+        // into string for UTF-16 keys, into the caller's buffer for UTF-8 keys
+        const char *key;
+        int size;
+        QString string;
+    };
+
+    QVector<Entry> entries;
+    // open addressing over entries, -1 = free; always a power of two in size
+    QVector<int> buckets;
+    int hitCount;
+
+    template <typename Make>
+    QString lookup(const char *key, int size, quint64 hash, Make make);
+    void grow();
+};
+
+#endif // TSCSTRINGPOOL_H
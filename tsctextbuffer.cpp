@@ -0,0 +1,36 @@
+#include "tsctextbuffer.h"
+
+TSCTextBuffer::TSCTextBuffer(const QByteArray &data, int capacity) :
+    data(data),
+    capacity(capacity),
+    spanCount(0),
+    spans(new Span[static_cast<size_t>(capacity)]),
+    texts(new QString[static_cast<size_t>(capacity)]),
+    states(new std::atomic<quint8>[static_cast<size_t>(capacity)])
+{
+    for (int i = 0; i < capacity; i++)
+        states[i].store(Undecoded, std::memory_order_relaxed);
+}
+
+int TSCTextBuffer::addSpan(int offset, int size)
+{
+    Q_ASSERT(offset >= 0 && size >= 0 && offset + size <= data.size());
+    if (spanCount >= capacity)
+        return -1;
+    spans[spanCount] = { offset, size };
+    return spanCount++;
+}
+
+QString TSCTextBuffer::text(int span) const
+{
+    if (states[span].load(std::memory_order_acquire) == Decoded)
+        return texts[span];
+    QString decoded = QString::fromUtf8(spanData(span), spanSize(span));
+    // if another thread is decoding the same span right now, ours just isn't kept
+    quint8 expected = Undecoded;
+    if (states[span].compare_exchange_strong(expected, Decoding, std::memory_order_relaxed)) {
+        texts[span] = decoded;
+        states[span].store(Decoded, std::memory_order_release);
+    }
+    return decoded;
+}
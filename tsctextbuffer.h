@@ -0,0 +1,51 @@
+#ifndef TSCTEXTBUFFER_H
+#define TSCTEXTBUFFER_H
+
+#include <QSharedData>
+#include <QString>
+#include <atomic>
+#include <memory>
+
+// The bytes of a list file, shared by every command whose description still
+// points into it (see TSCCommand::setDescriptionSource()). Each span is
+// decoded the first time anyone asks for it and kept here, so every copy of
+// a command (in the table, an undo step or a save snapshot) gets the cached
+// text. Decoding is lock-free and safe from any thread; spans are only added
+// while the file is being parsed, before any command refers to them.
+
+class TSCTextBuffer : public QSharedData
+{
+public:
+    // capacity is the most spans this buffer will ever hold
+    TSCTextBuffer(const QByteArray &data, int capacity);
+
+    const QByteArray &bytes() const { return data; }
+    // -1 once capacity is used up
+    int addSpan(int offset, int size);
+    int spanSize(int span) const { return spans[span].size; }
+    // the raw UTF-8 of a span, lives as long as the buffer
+    const char *spanData(int span) const { return data.constData() + spans[span].offset; }
+    QString text(int span) const;
+
+private:
+    enum State : quint8 {
+        Undecoded,
+        Decoding,
+        Decoded,
+    };
+
+    struct Span {
+        int offset;
+        int size;
+    };
+
+    QByteArray data;
+    int capacity;
+    int spanCount;
+    std::unique_ptr<Span[]> spans;
+    // written once, by whoever moves the state from Undecoded to Decoding
+    std::unique_ptr<QString[]> texts;
+    std::unique_ptr<std::atomic<quint8>[]> states;
+};
+
+#endif // TSCTEXTBUFFER_H
@@ -0,0 +1,156 @@
+#include "tsctrace.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QMutex>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace {
+
+struct Event {
+    const char *name;
+    qint64 start;
+    qint64 duration;
+};
+
+// exports read the slots while their thread may be overwriting them, so every field is atomic;
+// relaxed accesses compile to plain loads and stores, with a fence around them (see record())
+struct EventSlot {
+    std::atomic<const char *> name;
+    std::atomic<qint64> start;
+    std::atomic<qint64> duration;
+};
+
+struct ThreadBuffer {
+    int tid;
+    QString threadName;
+    std::unique_ptr<EventSlot[]> events;
+    // only ever written by the owning thread
+    std::atomic<quint64> written { 0 };
+    std::atomic<quint64> clearedAt { 0 };
+};
+
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+QMutex registryMutex;
+// buffers outlive their threads, so spans from finished workers still get exported
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+ThreadBuffer *localBuffer()
+{
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (buffer)
+        return buffer;
+    std::unique_ptr<ThreadBuffer> newBuffer(new ThreadBuffer);
+    newBuffer->events.reset(new EventSlot[TSCTrace::BufferSize]);
+    QThread *thread = QThread::currentThread();
+    QCoreApplication *app = QCoreApplication::instance();
+    QMutexLocker locker(&registryMutex);
+    newBuffer->tid = static_cast<int>(registry.size()) + 1;
+    if (app && thread == app->thread())
+        newBuffer->threadName = "Main thread";
+    else if (!thread->objectName().isEmpty())
+        newBuffer->threadName = thread->objectName();
+    else
+        newBuffer->threadName = QString("Worker %1").arg(newBuffer->tid);
+    buffer = newBuffer.get();
+    registry.push_back(std::move(newBuffer));
+    return buffer;
+}
+
+}
+
+void TSCTrace::setEnabled(bool on)
+{
+    enabled.store(on, std::memory_order_relaxed);
+}
+
+void TSCTrace::clear()
+{
+    QMutexLocker locker(&registryMutex);
+    for (const std::unique_ptr<ThreadBuffer> &buffer : registry)
+        buffer->clearedAt.store(buffer->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+qint64 TSCTrace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void TSCTrace::record(const char *name, qint64 start, qint64 duration)
+{
+    ThreadBuffer *buffer = localBuffer();
+    quint64 i = buffer->written.load(std::memory_order_relaxed);
+    // a seqlock, with written as the sequence: an exporter that sees any of these stores is
+    // guaranteed to see written >= i afterwards, so it knows slot i % BufferSize is being reused
+    std::atomic_thread_fence(std::memory_order_release);
+    EventSlot &slot = buffer->events[i % BufferSize];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.duration.store(duration, std::memory_order_relaxed);
+    buffer->written.store(i + 1, std::memory_order_release);
+}
+
+bool TSCTrace::exportChromeTrace(const QString &fileName, QString *fail)
+{
+    QJsonArray events;
+    {
+        QMutexLocker locker(&registryMutex);
+        for (const std::unique_ptr<ThreadBuffer> &buffer : registry) {
+            events += QJsonObject {
+                { "name", "thread_name" },
+                { "ph", "M" },
+                { "pid", 1 },
+                { "tid", buffer->tid },
+                { "args", QJsonObject { { "name", buffer->threadName } } },
+            };
+            quint64 end = buffer->written.load(std::memory_order_acquire);
+            quint64 begin = qMax(buffer->clearedAt.load(std::memory_order_relaxed), end > BufferSize ? end - BufferSize : 0);
+            std::vector<Event> copied;
+            copied.reserve(end - begin);
+            for (quint64 i = begin; i < end; i++) {
+                const EventSlot &slot = buffer->events[i % BufferSize];
+                copied.push_back({ slot.name.load(std::memory_order_relaxed),
+                                   slot.start.load(std::memory_order_relaxed),
+                                   slot.duration.load(std::memory_order_relaxed) });
+            }
+            // anything the thread started overwriting while we copied is dropped
+            std::atomic_thread_fence(std::memory_order_acquire);
+            quint64 after = buffer->written.load(std::memory_order_relaxed);
+            quint64 intact = after >= BufferSize ? after - BufferSize + 1 : 0;
+            for (quint64 i = qMax(begin, intact); i < end; i++) {
+                const Event &event = copied[i - begin];
+                events += QJsonObject {
+                    { "name", event.name },
+                    { "ph", "X" },
+                    { "pid", 1 },
+                    { "tid", buffer->tid },
+                    // microseconds
+                    { "ts", event.start / 1000.0 },
+                    { "dur", event.duration / 1000.0 },
+                };
+            }
+        }
+    }
+    QJsonObject trace {
+        { "traceEvents", events },
+        { "displayTimeUnit", "ms" },
+    };
+    QSaveFile dst(fileName);
+    if (!dst.open(QFile::WriteOnly)) {
+        *fail = "Could not open file for writing";
+        return false;
+    }
+    dst.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+    if (!dst.commit()) {
+        *fail = QString("Could not write file: %1").arg(dst.errorString());
+        return false;
+    }
+    return true;
+}
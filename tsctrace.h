@@ -0,0 +1,55 @@
+#ifndef TSCTRACE_H
+#define TSCTRACE_H
+
+#include <QString>
+#include <atomic>
+
+// Lightweight timing spans, for finding out where the time goes on big lists.
+// TSC_TRACE("name") times the rest of the enclosing scope. While tracing is
+// off that's one relaxed atomic load; while it's on, spans go into a ring
+// buffer owned by the recording thread (so no locking), and can be exported
+// as Chrome/Perfetto trace JSON (chrome://tracing, ui.perfetto.dev).
+// Span names must be string literals, or otherwise outlive the trace.
+
+class TSCTrace
+{
+public:
+    class Span
+    {
+    public:
+        explicit Span(const char *name) : name(isEnabled() ? name : nullptr), start(this->name ? now() : 0) {}
+        ~Span()
+        {
+            if (name)
+                record(name, start, now() - start);
+        }
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+    private:
+        const char *name;
+        qint64 start;
+    };
+
+    // spans kept per thread; older ones are overwritten
+    static constexpr int BufferSize = 1 << 16;
+
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool on);
+    static void clear();
+
+    // spans still being recorded by other threads while exporting may be left out
+    static bool exportChromeTrace(const QString &fileName, QString *fail);
+
+private:
+    static inline std::atomic<bool> enabled { false };
+
+    static qint64 now();
+    static void record(const char *name, qint64 start, qint64 duration);
+};
+
+#define TSC_TRACE_CONCAT_(a, b) a##b
+#define TSC_TRACE_CONCAT(a, b) TSC_TRACE_CONCAT_(a, b)
+#define TSC_TRACE(name) TSCTrace::Span TSC_TRACE_CONCAT(tscTraceSpan, __LINE__)(name)
+
+#endif // TSCTRACE_H
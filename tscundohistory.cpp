@@ -0,0 +1,262 @@
+#include "tscundohistory.h"
+#include "tsccommandmodel.h"
+#include "tsctrace.h"
+
+TSCUndoHistory::TSCUndoHistory(TSCCommandModel *model, QObject *parent)
+    : QObject(parent)
+    , model(model)
+    , current(0)
+    , cleanIndex(0)
+    , bytes(0)
+    , budget(DefaultByteBudget)
+    , group { QString(), {}, 0 }
+    , groupDepth(0)
+    , replaying(false)
+{
+}
+
+void TSCUndoHistory::setByteBudget(qint64 bytes)
+{
+    budget = bytes;
+    trim();
+}
+
+QString TSCUndoHistory::undoText() const
+{
+    return canUndo() ? steps[current - 1].text : QString();
+}
+
+QString TSCUndoHistory::redoText() const
+{
+    return canRedo() ? steps[current].text : QString();
+}
+
+void TSCUndoHistory::setClean()
+{
+    cleanIndex = current;
+    emit changed();
+}
+
+void TSCUndoHistory::resetClean()
+{
+    cleanIndex = -1;
+    emit changed();
+}
+
+void TSCUndoHistory::clear()
+{
+    steps.clear();
+    current = 0;
+    cleanIndex = 0;
+    bytes = 0;
+    group = { QString(), {}, 0 };
+    groupDepth = 0;
+    emit changed();
+}
+
+void TSCUndoHistory::beginGroup(const QString &text)
+{
+    if (groupDepth++ == 0)
+        group = { text, {}, 0 };
+}
+
+void TSCUndoHistory::endGroup()
+{
+    Q_ASSERT(groupDepth > 0);
+    if (--groupDepth > 0)
+        return;
+    Step finished = std::move(group);
+    group = { QString(), {}, 0 };
+    if (!finished.changes.isEmpty())
+        push(std::move(finished));
+    else
+        emit changed();
+}
+
+void TSCUndoHistory::recordInsert(int row)
+{
+    record({ Change::Insert, row, model->table().at(row), {}, {} }, "Add command");
+}
+
+void TSCUndoHistory::recordRemove(int row, const TSCCommand &cmd)
+{
+    record({ Change::Remove, row, cmd, {}, {} }, "Remove command");
+}
+
+void TSCUndoHistory::recordReplace(int row, const TSCCommand &oldCmd)
+{
+    record({ Change::Replace, row, oldCmd, {}, {} }, "Edit command");
+}
+
+void TSCUndoHistory::recordMove(const QVector<int> &newRows)
+{
+    record({ Change::Move, -1, TSCCommand(), newRows, {} }, "Sort commands");
+}
+
+void TSCUndoHistory::recordInsertRows(const QVector<int> &rows)
+{
+    QVector<TSCCommand> cmds;
+    cmds.reserve(rows.size());
+    for (int row : rows)
+        cmds += model->table().at(row);
+    record({ Change::InsertRows, -1, TSCCommand(), rows, cmds }, QString("Add %1 commands").arg(rows.size()));
+}
+
+void TSCUndoHistory::recordRemoveRows(const QVector<int> &rows, const QVector<TSCCommand> &cmds)
+{
+    record({ Change::RemoveRows, -1, TSCCommand(), rows, cmds }, QString("Remove %1 commands").arg(rows.size()));
+}
+
+void TSCUndoHistory::recordReplaceRows(const QVector<int> &rows, const QVector<TSCCommand> &oldCmds)
+{
+    record({ Change::ReplaceRows, -1, TSCCommand(), rows, oldCmds }, QString("Edit %1 commands").arg(rows.size()));
+}
+
+void TSCUndoHistory::record(Change change, const QString &text)
+{
+    if (replaying)
+        return;
+    detachDescriptions(change);
+    // the inserted commands are still in the table; they only have to be kept once undone
+    qint64 size = changeBytes(change);
+    if (change.kind == Change::Insert)
+        change.cmd = TSCCommand();
+    if (change.kind == Change::InsertRows)
+        change.cmds.clear();
+    if (groupDepth > 0) {
+        group.changes += std::move(change);
+        group.bytes += size;
+        return;
+    }
+    push({ text, { std::move(change) }, size });
+}
+
+void TSCUndoHistory::push(Step step)
+{
+    // a new step replaces everything that could have been redone
+    for (int i = current; i < steps.size(); i++)
+        bytes -= steps[i].bytes;
+    steps.resize(current);
+    if (cleanIndex > current)
+        cleanIndex = -1;
+    bytes += step.bytes;
+    steps += std::move(step);
+    current++;
+    trim();
+    emit changed();
+}
+
+void TSCUndoHistory::trim()
+{
+    // always keep the latest step, however big it is
+    int drop = 0;
+    while (bytes > budget && drop < current - 1) {
+        bytes -= steps[drop].bytes;
+        drop++;
+    }
+    if (drop == 0)
+        return;
+    steps.remove(0, drop);
+    current -= drop;
+    cleanIndex = cleanIndex >= drop ? cleanIndex - drop : -1;
+}
+
+void TSCUndoHistory::undo()
+{
+    TSC_TRACE("TSCUndoHistory::undo");
+    if (!canUndo())
+        return;
+    replaying = true;
+    Step &step = steps[--current];
+    for (int i = step.changes.size() - 1; i >= 0; i--)
+        apply(step.changes[i], false);
+    replaying = false;
+    emit changed();
+}
+
+void TSCUndoHistory::redo()
+{
+    TSC_TRACE("TSCUndoHistory::redo");
+    if (!canRedo())
+        return;
+    replaying = true;
+    Step &step = steps[current++];
+    for (Change &change : step.changes)
+        apply(change, true);
+    replaying = false;
+    emit changed();
+}
+
+void TSCUndoHistory::apply(Change &change, bool forward)
+{
+    switch (change.kind) {
+    case Change::Insert:
+    case Change::Remove:
+        // undoing an insert is a remove, and the other way around
+        if ((change.kind == Change::Insert) == forward) {
+            model->insertCommand(change.row, change.cmd);
+            change.cmd = TSCCommand();
+        } else {
+            change.cmd = model->table().at(change.row);
+            model->removeCommand(change.row);
+        }
+        break;
+    case Change::Replace: {
+        TSCCommand other = model->table().at(change.row);
+        model->replaceCommand(change.row, change.cmd);
+        change.cmd = std::move(other);
+        break;
+    }
+    case Change::Move:
+        if (forward) {
+            model->permuteRows(change.rows);
+        } else {
+            QVector<int> oldRows(change.rows.size());
+            for (int row = 0; row < change.rows.size(); row++)
+                oldRows[change.rows[row]] = row;
+            model->permuteRows(oldRows);
+        }
+        break;
+    case Change::InsertRows:
+    case Change::RemoveRows:
+        if ((change.kind == Change::InsertRows) == forward) {
+            model->insertCommands(change.rows, change.cmds);
+            change.cmds.clear();
+        } else {
+            change.cmds.reserve(change.rows.size());
+            for (int row : qAsConst(change.rows))
+                change.cmds += model->table().at(row);
+            model->removeCommands(change.rows);
+        }
+        break;
+    case Change::ReplaceRows: {
+        QVector<TSCCommand> others;
+        others.reserve(change.rows.size());
+        for (int row : qAsConst(change.rows))
+            others += model->table().at(row);
+        model->replaceCommands(change.rows, change.cmds);
+        change.cmds = std::move(others);
+        break;
+    }
+    }
+    detachDescriptions(change);
+}
+
+void TSCUndoHistory::detachDescriptions(Change &change)
+{
+    // a command still pointing into a list file would keep all of that file alive, unaccounted for
+    change.cmd.decodeDescription();
+    for (TSCCommand &cmd : change.cmds)
+        cmd.decodeDescription();
+}
+
+qint64 TSCUndoHistory::changeBytes(const Change &change)
+{
+    // strings are counted as if nothing else shared them, so this errs on the high side
+    qint64 size = static_cast<qint64>(sizeof(Change))
+            + (change.cmd.name.size() + change.cmd.descriptionSizeHint()) * static_cast<qint64>(sizeof(QChar))
+            + change.rows.size() * static_cast<qint64>(sizeof(int));
+    for (const TSCCommand &cmd : change.cmds)
+        size += static_cast<qint64>(sizeof(TSCCommand)) + (cmd.name.size() + cmd.descriptionSizeHint()) * static_cast<qint64>(sizeof(QChar));
+    return size;
+}
@@ -0,0 +1,106 @@
+#ifndef TSCUNDOHISTORY_H
+#define TSCUNDOHISTORY_H
+
+#include <QObject>
+#include <QVector>
+#include "tsccommand.h"
+
+class TSCCommandModel;
+
+// Undo/redo history of a TSCCommandModel, which records every change into it.
+// Steps only keep the rows they touched (commands share their strings with
+// the table, so even those are cheap), never a copy of the whole list, and
+// the oldest steps are dropped once the history grows past its byte budget.
+// Kept commands get descriptions of their own rather than pointing into the
+// file they were loaded from, so the budget covers everything a step holds.
+
+class TSCUndoHistory : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr qint64 DefaultByteBudget = 16 * 1024 * 1024;
+
+    explicit TSCUndoHistory(TSCCommandModel *model, QObject *parent = nullptr);
+
+    qint64 byteBudget() const { return budget; }
+    void setByteBudget(qint64 bytes);
+    qint64 byteSize() const { return bytes; }
+
+    int count() const { return steps.size(); }
+    bool canUndo() const { return current > 0 && groupDepth == 0; }
+    bool canRedo() const { return current < steps.size() && groupDepth == 0; }
+    QString undoText() const;
+    QString redoText() const;
+
+    // clean = matches what's on disk
+    bool isClean() const { return cleanIndex == current; }
+    void setClean();
+    void resetClean();
+    void clear();
+
+    // every change until the matching endGroup() is undone and redone as one step
+    void beginGroup(const QString &text);
+    void endGroup();
+
+    void recordInsert(int row);
+    void recordRemove(int row, const TSCCommand &cmd);
+    void recordReplace(int row, const TSCCommand &oldCmd);
+    void recordMove(const QVector<int> &newRows);
+    // batches of rows (in ascending order) that were changed in one go
+    void recordInsertRows(const QVector<int> &rows);
+    void recordRemoveRows(const QVector<int> &rows, const QVector<TSCCommand> &cmds);
+    void recordReplaceRows(const QVector<int> &rows, const QVector<TSCCommand> &oldCmds);
+
+public slots:
+    void undo();
+    void redo();
+
+signals:
+    void changed();
+
+private:
+    struct Change {
+        enum Kind : quint8 {
+            Insert,
+            Remove,
+            Replace,
+            Move,
+            InsertRows,
+            RemoveRows,
+            ReplaceRows,
+        };
+        Kind kind;
+        int row;
+        // whichever version of the command is currently not in the table
+        TSCCommand cmd;
+        // Move: rows[old row] = new row; batches: the rows, ascending
+        QVector<int> rows;
+        // batches only; like cmd, but for every row
+        QVector<TSCCommand> cmds;
+    };
+
+    struct Step {
+        QString text;
+        QVector<Change> changes;
+        qint64 bytes;
+    };
+
+    TSCCommandModel *model;
+    QVector<Step> steps;
+    int current;
+    int cleanIndex;
+    qint64 bytes;
+    qint64 budget;
+    Step group;
+    int groupDepth;
+    bool replaying;
+
+    void record(Change change, const QString &text);
+    void push(Step step);
+    void trim();
+    void apply(Change &change, bool forward);
+    static void detachDescriptions(Change &change);
+    static qint64 changeBytes(const Change &change);
+};
+
+#endif // TSCUNDOHISTORY_H